@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""
+Concurrent-client throughput of SEMANTIC_QUERY: N client threads, each with its own cursor on one database, run a mix
+of compile-only, rollup-hit and rollup-miss queries for a fixed time. Prints one CSV line per client count
+(commit,rows,clients,queries,qps,p50_ms,p99_ms) so runs of different commits can be compared.
+"""
+
+import argparse
+import statistics
+import subprocess
+import threading
+import time
+
+import duckdb
+
+QUERY_FILES = ["compile_cached", "rollup_hit", "rollup_miss"]
+
+
+def load_query(name):
+    with open(f"benchmark/semantic/queries/{name}.sql") as f:
+        return "\n".join(line for line in f.read().splitlines() if not line.startswith("--"))
+
+
+def setup(conn, rows):
+    with open("benchmark/semantic/semantic.benchmark.in") as f:
+        template = f.read()
+    load = template.split("\nload\n", 1)[1].split("\n\n", 1)[0]
+    conn.execute(load.replace("${ROWS}", str(rows)).replace("${MEMBERS}", "10"))
+
+
+def run_clients(conn, queries, clients, duration):
+    latencies = []
+    lock = threading.Lock()
+    deadline = time.perf_counter() + duration
+
+    def client(client_idx):
+        cursor = conn.cursor()
+        local = []
+        i = client_idx
+        while time.perf_counter() < deadline:
+            start = time.perf_counter()
+            cursor.execute(queries[i % len(queries)]).fetchall()
+            local.append(time.perf_counter() - start)
+            i += 1
+        with lock:
+            latencies.extend(local)
+
+    threads = [threading.Thread(target=client, args=(i,)) for i in range(clients)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return latencies
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--extension", default="build/release/extension/quack/quack.duckdb_extension")
+    parser.add_argument("--rows", type=int, default=1000000)
+    parser.add_argument("--clients", default="1,4,16")
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds per client count")
+    args = parser.parse_args()
+
+    conn = duckdb.connect(config={"allow_unsigned_extensions": "true"})
+    conn.execute(f"LOAD '{args.extension}'")
+    setup(conn, args.rows)
+    queries = [load_query(name) for name in QUERY_FILES]
+    commit = subprocess.run(["git", "rev-parse", "--short", "HEAD"], capture_output=True, text=True).stdout.strip()
+
+    print("commit,rows,clients,queries,qps,p50_ms,p99_ms")
+    for clients in (int(c) for c in args.clients.split(",")):
+        latencies = sorted(run_clients(conn, queries, clients, args.duration))
+        p99 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.99))]
+        print(f"{commit},{args.rows},{clients},{len(latencies)},{len(latencies) / args.duration:.1f},"
+              f"{statistics.median(latencies) * 1000:.3f},{p99 * 1000:.3f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,2 @@
+-- The same query as compile_cold, served from the plan cache after the first run
+SELECT * FROM SEMANTIC_QUERY('{"dataset": "bench_orders", "measures": ["revenue", "order_count"], "dimensions": ["region"], "time_dimensions": [{"dimension": "order_date", "granularity": "month", "date_range": ["2021-01-01", "2021-12-31"]}], "filters": [{"dimension": "region", "operator": "equals", "values": ["region_1", "region_2"]}]}', true);
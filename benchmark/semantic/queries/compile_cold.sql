@@ -0,0 +1,3 @@
+-- Parse, validate and compile with the plan cache disabled (explain mode, nothing is executed)
+SET semantic_plan_cache_size = 0;
+SELECT * FROM SEMANTIC_QUERY('{"dataset": "bench_orders", "measures": ["revenue", "order_count"], "dimensions": ["region"], "time_dimensions": [{"dimension": "order_date", "granularity": "month", "date_range": ["2021-01-01", "2021-12-31"]}], "filters": [{"dimension": "region", "operator": "equals", "values": ["region_1", "region_2"]}]}', true);
@@ -0,0 +1,2 @@
+-- Re-registers the dataset: parsing the definition, binding its members and persisting it
+SELECT REGISTER_DATASET(name, definition) FROM __semantic_datasets WHERE name = 'bench_orders';
@@ -0,0 +1,2 @@
+-- Answered from the daily_by_region rollup
+SELECT * FROM SEMANTIC_QUERY('{"dataset": "bench_orders", "measures": ["revenue", "order_count"], "dimensions": ["region"], "time_dimensions": [{"dimension": "order_date", "granularity": "month", "date_range": ["2021-01-01", "2021-12-31"]}], "filters": [{"dimension": "region", "operator": "equals", "values": ["region_1", "region_2"]}]}');
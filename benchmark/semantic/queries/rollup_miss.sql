@@ -0,0 +1,2 @@
+-- customer_id is not in any rollup, so this scans and aggregates the fact table (top 10 customers by revenue)
+SELECT * FROM SEMANTIC_QUERY('{"dataset": "bench_orders", "measures": ["revenue", "order_count"], "dimensions": ["customer_id"], "time_dimensions": [{"dimension": "order_date", "date_range": ["2021-01-01", "2021-12-31"]}], "order": [{"id": "revenue", "desc": true}], "limit": 10}');
@@ -1,32 +1,96 @@
 #pragma once
 
 #include "duckdb.hpp"
+#include "duckdb/common/atomic.hpp"
+#include "duckdb/common/mutex.hpp"
+#include "duckdb/common/optional_idx.hpp"
 #include "duckdb/function/table_function.hpp"
 #include "duckdb/parser/parsed_data/create_table_function_info.hpp"
+#include "duckdb/parser/parsed_expression.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include "semantic_plan_cache.hpp"
+#include "semantic_query_stats.hpp"
+#include "semantic_result_cache.hpp"
+
+#include <memory>
 
 namespace duckdb {
 
 // Forward declarations
 struct SemanticQueryData;
-struct DatasetRegistry;
+class DatasetRegistry;
+class SelectNode;
+class TableRef;
 
 // Semantic Query API structures
 struct SemanticMeasure {
+	static constexpr double DEFAULT_PERCENTILE = 0.5;
+
 	string name;
+	//! sum, count, count_distinct, avg, min, max, approx_count_distinct or approx_percentile
 	string aggregation_type;
 	string sql_expression;
+	//! Fraction computed by an approx_percentile measure
+	double percentile = DEFAULT_PERCENTILE;
+	//! The aggregate computed for the measure, built once at registration (see CompileMeasureExpression)
+	unique_ptr<ParsedExpression> expression;
+	//! Indexes into the dataset's joins that the sql refers to, with the joins those depend on, in ascending order -
+	//! resolved when the dataset is constructed
+	vector<idx_t> joins;
 };
 
 struct SemanticDimension {
 	string name;
 	string sql_expression;
+	//! The explicit "type" of the dimension, or the type of sql_expression over the source table, inferred from the
+	//! catalog at registration - INVALID if neither is known
 	LogicalType data_type;
+	//! sql_expression parsed once at registration
+	unique_ptr<ParsedExpression> expression;
+	//! Indexes into the dataset's joins that the sql refers to, like SemanticMeasure::joins
+	vector<idx_t> joins;
+};
+
+//! A table joined to the table of a dataset. The sql of members refers to its columns qualified with the join name
+//! (as in "customers.region"), and queries only join the tables that their members and filters refer to.
+struct SemanticJoin {
+	string name;
+	//! The joined table - the join name if not set
+	string table;
+	//! Join condition, e.g. "orders.customer_id = customers.id"
+	string sql_on;
+	//! many_to_one (the default) or one_to_one: every row of the dataset matches at most one row of the table.
+	//! one_to_many: every row of the table matches at most one row of the dataset. Such a join would repeat the rows
+	//! of the dataset, so the table is aggregated by the join key to the measures over it before it is joined.
+	string relationship;
+	//! Optional aggregate over the joined table that changes whenever its rows change (see
+	//! SemanticDataset::refresh_key)
+	string refresh_key;
+	unique_ptr<ParsedExpression> condition;
+	//! Indexes into the dataset's joins that the condition refers to, with the joins those depend on
+	vector<idx_t> dependencies;
+	//! For one_to_many joins, the equalities of the condition split into their sides: the expressions over the
+	//! dataset and those over the joined table
+	vector<unique_ptr<ParsedExpression>> dataset_keys;
+	vector<unique_ptr<ParsedExpression>> table_keys;
+
+	bool IsOneToMany() const {
+		return relationship == "one_to_many";
+	}
 };
 
 struct SemanticFilter {
 	string dimension;
+	//! equals, not_equals, gt, gte, lt, lte, between, in_date_range, contains, starts_with, set or not_set - or
+	//! "and"/"or" for a group of filters
 	string operator_;
 	vector<string> values;
+	//! The filters of an "and" or "or" group
+	vector<SemanticFilter> filters;
+
+	bool IsGroup() const {
+		return operator_ == "and" || operator_ == "or";
+	}
 };
 
 struct SemanticTimeDimension {
@@ -51,19 +115,256 @@ struct SemanticQuery {
 	string time_zone;
 };
 
+//! A pre-aggregation of a dataset: its measures grouped by a set of dimensions and, optionally, one time dimension
+//! truncated to a granularity. Rollups are materialized into tables by materialize_semantic_rollups().
+struct SemanticRollup {
+	string name;
+	vector<string> measures;
+	vector<string> dimensions;
+	string time_dimension;
+	string granularity;
+
+	//! Indexes of the members above in the dataset, resolved when the dataset is constructed
+	vector<idx_t> measure_indexes;
+	vector<idx_t> dimension_indexes;
+	optional_idx time_dimension_index;
+	//! Table the rollup is materialized into
+	string table_name;
+	//! Whether the table holds this rollup of this dataset definition - only materialized rollups are routed to
+	bool materialized = false;
+	idx_t row_count = 0;
+};
+
+//! Outcome of building or refreshing one rollup
+struct SemanticRollupRefresh {
+	string dataset;
+	string rollup;
+	string table_name;
+	//! Time partitions that were recomputed or removed (1 for a rebuilt rollup without a time dimension)
+	idx_t partitions = 0;
+	//! Rows written to the rollup table
+	idx_t rows = 0;
+	//! Rows in the rollup table afterwards
+	idx_t row_count = 0;
+	//! In seconds
+	double duration = 0;
+};
+
+//! Statistics of the rows of a dataset, computed on demand by refresh_semantic_dataset_stats()
+struct SemanticDatasetStatistics {
+	idx_t row_count = 0;
+	//! Per dimension of the dataset: its approximate number of distinct values (a HyperLogLog estimate)
+	vector<idx_t> cardinalities;
+	//! Per dimension: its smallest and largest value as a TIMESTAMP - NULL for dimensions that are not dates or
+	//! timestamps
+	vector<Value> min_values;
+	vector<Value> max_values;
+	timestamp_t analyzed_at;
+};
+
+//! Outcome of computing the statistics of one dataset
+struct SemanticStatisticsRefresh {
+	string dataset;
+	idx_t row_count = 0;
+	//! In seconds
+	double duration = 0;
+};
+
+//! A registered dataset, with name -> index maps over its members
+struct SemanticDataset {
+	SemanticDataset(string name, vector<SemanticMeasure> measures, vector<SemanticDimension> dimensions,
+	                vector<SemanticRollup> rollups = vector<SemanticRollup>(),
+	                vector<SemanticJoin> joins = vector<SemanticJoin>());
+
+	string name;
+	vector<SemanticMeasure> measures;
+	//! Regular and time dimensions
+	vector<SemanticDimension> dimensions;
+	vector<SemanticRollup> rollups;
+	//! Tables joined to the dataset's table, in declaration order - a join may only depend on joins declared before it
+	vector<SemanticJoin> joins;
+	//! Optional aggregate over the rows of a time partition (e.g. max(updated_at)) that changes whenever the rows of
+	//! the partition change - incremental rollup refreshes and the result cache otherwise only notice changes to row
+	//! counts. It has to change with every write, so it is best a maximum of a column that each write raises.
+	string refresh_key;
+	//! Seconds results of this dataset stay in the result cache - the semantic_result_cache_ttl setting if not set
+	optional_idx result_cache_ttl;
+	//! Month (1-12) the fiscal_quarter and fiscal_year granularities start their year in
+	idx_t fiscal_year_start_month = 1;
+	//! Optional table of precomputed periods (see semantic_calendar()) that fiscal granularities are looked up in,
+	//! by calendar_date, instead of being computed for every row
+	string calendar_table;
+	//! The JSON definition the dataset was parsed from - this is what gets persisted
+	string definition;
+	//! Statistics of the rows of the dataset, if they were computed for this definition
+	shared_ptr<const SemanticDatasetStatistics> statistics;
+	//! Registry-wide unique version of this definition, assigned when it is published
+	idx_t version = 0;
+
+	optional_idx FindMeasure(const string &member_name) const;
+	optional_idx FindDimension(const string &member_name) const;
+	optional_idx FindJoin(const string &join_name) const;
+
+private:
+	unordered_map<string, idx_t> measure_index;
+	unordered_map<string, idx_t> dimension_index;
+	unordered_map<string, idx_t> join_index;
+};
+
+//! A semantic query with its members resolved against a dataset
+struct BoundSemanticQuery {
+	shared_ptr<const SemanticDataset> dataset;
+	//! Indexes into dataset->measures, in query order
+	vector<idx_t> measures;
+	//! Indexes into dataset->dimensions, in query order
+	vector<idx_t> dimensions;
+	//! Indexes into dataset->dimensions, one per SemanticQuery::time_dimensions entry
+	vector<idx_t> time_dimensions;
+	//! Index into dataset->dimensions per filter, with the filters of groups in depth-first order (groups themselves
+	//! have no entry) - invalid for filters on a raw column name
+	vector<optional_idx> filters;
+	//! equals/not_equals filters with more values than this are compiled to a semi-join against a LIST constant of
+	//! the values instead of an IN list (see the semantic_in_list_threshold setting)
+	idx_t in_list_threshold = DConstants::INVALID_INDEX;
+	//! Index into dataset->rollups of the rollup the query is answered from, if any
+	optional_idx rollup;
+	//! Whether the rollup groups by more than the query, so its measures have to be aggregated again
+	bool reaggregate_rollup = false;
+};
+
+//! Queries of a batch that are answered by one shared scan of their dataset (see CompileSemanticQueryGroup)
+struct SemanticQueryGroup {
+	//! Indexes of the queries in the batch
+	vector<idx_t> queries;
+	//! Union of the measures and dimensions of the queries, as indexes into the dataset, in order of appearance
+	vector<idx_t> measures;
+	vector<idx_t> dimensions;
+};
+
+//! A semantic query split into one query per time partition of the date_range of one of its time dimensions (see
+//! CompilePartitionedSemanticQuery)
+struct SemanticPartitionedQuery {
+	static constexpr const char *RESULTS_TABLE = "__semantic_partition_results";
+
+	shared_ptr<const SemanticDataset> dataset;
+	//! Compiled SQL of the query over each partition, in time order. Partitions are routed to rollups one by one.
+	vector<string> partitions;
+	//! The rows of the dataset each partition reads, as "<from> WHERE <condition>" - its cached result is tied to the
+	//! fingerprint of just these rows
+	vector<string> partition_sources;
+	//! Whether groups of the query can span partitions, so their partial aggregates have to be merged
+	bool merge = false;
+	//! Per result column: the aggregate that merges its partial values (sum, min or max), empty for group columns
+	vector<string> merge_functions;
+	//! The result columns of the unpartitioned query. Partitions served from rollups and from the dataset's table can
+	//! return different types (e.g. HUGEINT and BIGINT sums), so they are all cast to these.
+	vector<string> names;
+	vector<LogicalType> types;
+	vector<SemanticOrder> order;
+	int64_t limit = -1;
+};
+
 // Dataset registry for validation
-class DatasetRegistry {
+// Each DatabaseInstance has its own registry, stored in its ObjectCache. Definitions are persisted in the
+// __semantic_datasets table of the database, so a restarted database comes up with its datasets loaded.
+// Readers never take a lock: the registry publishes an immutable snapshot of all datasets, and registration builds
+// a new snapshot (copy-on-write) and swaps it in atomically. Readers therefore never block behind a writer and never
+// observe a partially registered dataset.
+class DatasetRegistry : public ObjectCacheEntry {
 public:
-	static DatasetRegistry &GetInstance();
-	void RegisterDataset(const string &name, const vector<SemanticMeasure> &measures,
-	                     const vector<SemanticDimension> &dimensions);
-	bool ValidateQuery(const SemanticQuery &query, string &error_msg);
-	const vector<SemanticMeasure> *GetMeasures(const string &dataset_name);
-	const vector<SemanticDimension> *GetDimensions(const string &dataset_name);
+	using DatasetMap = unordered_map<string, shared_ptr<const SemanticDataset>>;
+	static constexpr const char *OBJECT_TYPE = "semantic_dataset_registry";
+	static constexpr const char *PERSISTENCE_TABLE = "__semantic_datasets";
+	static constexpr const char *ROLLUP_STATE_TABLE = "__semantic_rollups";
+	static constexpr const char *ROLLUP_PARTITIONS_TABLE = "__semantic_rollup_partitions";
+	static constexpr idx_t DEFAULT_IN_LIST_THRESHOLD = 100;
+
+	DatasetRegistry();
+
+	static DatasetRegistry &Get(ClientContext &context);
+	static DatasetRegistry &Get(DatabaseInstance &db);
+
+	//! Persists the dataset definition in the database and publishes the dataset
+	void RegisterDataset(DatabaseInstance &db, shared_ptr<SemanticDataset> dataset);
+	//! Persists all definitions in one transaction and publishes them with a single snapshot swap
+	void RegisterDatasets(DatabaseInstance &db, vector<shared_ptr<SemanticDataset>> datasets);
+	//! Publishes all dataset definitions persisted in the database
+	void LoadPersistedDatasets(DatabaseInstance &db);
+	//! Brings the rollup tables of the datasets up to date and publishes versions of the datasets that route queries
+	//! to them. Rollups that are already materialized are refreshed incrementally, by time partition, unless
+	//! full_rebuild is set.
+	vector<SemanticRollupRefresh> RefreshRollups(DatabaseInstance &db, const vector<string> &dataset_names,
+	                                             bool full_rebuild);
+	//! Computes the statistics of the datasets and publishes versions of the datasets that carry them
+	vector<SemanticStatisticsRefresh> RefreshStatistics(DatabaseInstance &db, const vector<string> &dataset_names);
+	//! Resolves the members of the query against its dataset, filling in "bound", and refuses queries estimated to
+	//! return more than semantic_max_groups groups
+	bool ValidateQuery(const SemanticQuery &query, BoundSemanticQuery &bound, string &error_msg);
+	shared_ptr<const SemanticDataset> GetDataset(const string &dataset_name);
+	//! The current snapshot of all registered datasets
+	std::shared_ptr<const DatasetMap> GetSnapshot() const;
+	SemanticPlanCache &GetPlanCache() {
+		return plan_cache_;
+	}
+	SemanticQueryStats &GetQueryStats() {
+		return query_stats_;
+	}
+	SemanticResultCache &GetResultCache() {
+		return result_cache_;
+	}
+	idx_t GetInListThreshold() const {
+		return in_list_threshold_;
+	}
+	void SetInListThreshold(idx_t threshold) {
+		in_list_threshold_ = threshold;
+	}
+	idx_t GetMaxGroups() const {
+		return max_groups_;
+	}
+	void SetMaxGroups(idx_t max_groups) {
+		max_groups_ = max_groups;
+	}
+	bool GetWarmup() const {
+		return warmup_;
+	}
+	void SetWarmup(bool warmup) {
+		warmup_ = warmup;
+	}
+
+	static string ObjectType() {
+		return OBJECT_TYPE;
+	}
+	string GetObjectType() override {
+		return ObjectType();
+	}
 
 private:
-	unordered_map<string, vector<SemanticMeasure>> dataset_measures_;
-	unordered_map<string, vector<SemanticDimension>> dataset_dimensions_;
+	void PersistDatasets(DatabaseInstance &db, const vector<shared_ptr<SemanticDataset>> &datasets);
+	//! Marks the rollups whose tables were built from the current definition of their dataset as materialized
+	void LoadRollupState(Connection &con, vector<shared_ptr<SemanticDataset>> &datasets);
+	//! Swaps in a snapshot containing the datasets, returning their names - requires the write lock
+	vector<string> PublishDatasets(vector<shared_ptr<SemanticDataset>> datasets);
+	//! With semantic_warmup on, compiles the warmup queries of the datasets (see GetSemanticWarmupQueries) into the
+	//! plan cache. Called once the published datasets are visible, without the write lock, so that other writers do
+	//! not wait for the compiles.
+	void WarmupDatasets(const vector<string> &dataset_names);
+
+	//! Serializes writers - readers only load the snapshot
+	mutex write_lock_;
+	//! Serializes rollup builds, which are published under the write lock but do not hold it while they run
+	mutex rollup_lock_;
+	idx_t last_version_ = 0;
+	//! Only accessed through std::atomic_load / std::atomic_store
+	std::shared_ptr<const DatasetMap> snapshot_;
+	SemanticPlanCache plan_cache_;
+	SemanticQueryStats query_stats_;
+	SemanticResultCache result_cache_;
+	atomic<idx_t> in_list_threshold_ {DEFAULT_IN_LIST_THRESHOLD};
+	//! Largest number of groups a query is predicted to return that is compiled, 0 for no limit (see the
+	//! semantic_max_groups setting)
+	atomic<idx_t> max_groups_ {0};
+	//! Whether published datasets are warmed up (see the semantic_warmup setting)
+	atomic<bool> warmup_ {true};
 };
 
 class QuackExtension : public Extension {
@@ -75,7 +376,61 @@ public:
 
 // Semantic Query API functions
 SemanticQuery ParseSemanticQuery(const string &json_str);
-string CompileSemanticQueryToSQL(const SemanticQuery &query);
+//! Parses a JSON array of semantic queries
+vector<SemanticQuery> ParseSemanticQueryBatch(const string &json_str);
+//! Parses a dataset definition. An empty name takes the definition's "name" field.
+shared_ptr<SemanticDataset> ParseSemanticDataset(const string &name, const string &definition_json);
+unique_ptr<ParsedExpression> ParseSemanticExpression(const string &sql);
+//! Parses the sql of a measure into the aggregate of its aggregation type
+unique_ptr<ParsedExpression> CompileMeasureExpression(const SemanticMeasure &measure);
+//! Whether partial values of the measure, over parts of its rows, combine into its value: sum, count, min and max
+//! aggregates, generated from the measure's sql or written out as exactly that aggregate
+bool IsCombinableMeasure(const SemanticMeasure &measure);
+//! hour, day, week, month, quarter, year, fiscal_quarter or fiscal_year
+bool IsSupportedGranularity(const string &granularity);
+//! Whether values truncated to the "from" granularity can be truncated further to the "to" granularity, i.e. every
+//! "to" period is made up of whole "from" periods
+bool GranularityRollsUp(const string &from, const string &to);
+//! Truncates a time expression to the start of its period at the granularity
+unique_ptr<ParsedExpression> CompileTimeTruncation(const string &granularity, unique_ptr<ParsedExpression> expr,
+                                                   idx_t fiscal_year_start_month);
+//! The dataset's table LEFT JOINed with the given joins (ascending indexes into dataset.joins). one_to_many joins
+//! are aggregated by their key to those of the measures that are over them.
+unique_ptr<TableRef> CompileDatasetSource(const SemanticDataset &dataset, const vector<idx_t> &joins,
+                                          const vector<idx_t> &measures);
+unique_ptr<SelectNode> CompileSemanticQuery(const SemanticQuery &query, const BoundSemanticQuery &bound);
+string CompileSemanticQueryToSQL(const SemanticQuery &query, const BoundSemanticQuery &bound);
+unique_ptr<SelectNode> CompileSemanticQueryGroup(const vector<SemanticQuery> &queries,
+                                                 const vector<BoundSemanticQuery> &bound,
+                                                 const SemanticQueryGroup &group);
+//! Parses, validates and compiles a semantic query JSON document, going through the plan cache of the registry.
+//! A repeat of the exact query text is not parsed. "dataset_name" is set as soon as it is known, so that it is
+//! there for the stats of a failed query too.
+unique_ptr<QueryNode> CompileCachedSemanticQuery(DatasetRegistry &registry, const string &query_json,
+                                                 string &dataset_name, shared_ptr<const SemanticDataset> &dataset,
+                                                 SemanticQueryTimings &timings, bool &plan_cache_hit);
+//! Compiles a query that was already parsed and validated (into "bound"), going through the plan cache by its key
+unique_ptr<QueryNode> CompileCachedSemanticQuery(DatasetRegistry &registry, const SemanticQuery &semantic_query,
+                                                 BoundSemanticQuery &bound_query, bool &plan_cache_hit);
+//! Predicted number of groups of the query, from the statistics of its dataset - invalid without statistics
+optional_idx EstimateSemanticQueryGroups(const SemanticQuery &query, const BoundSemanticQuery &bound);
+//! The queries that warmups precompile for the dataset: the query each of its rollups answers, as JSON documents
+vector<string> GetSemanticWarmupQueries(const SemanticDataset &dataset);
+//! Picks the smallest materialized rollup that can answer the query, if any, and records it in "bound"
+void RouteSemanticQuery(const SemanticQuery &query, BoundSemanticQuery &bound);
+//! Splits the query by the partitions of the given granularity (day, month, quarter or year) that the date_range of
+//! its first time dimension with one covers
+SemanticPartitionedQuery CompilePartitionedSemanticQuery(ClientContext &context, const string &query_json,
+                                                         const string &partition_granularity);
+//! Runs the partitions side by side, each through the result cache when it is enabled, and merges their results
+shared_ptr<const SemanticCachedResult> ExecutePartitionedSemanticQuery(ClientContext &context,
+                                                                       const SemanticPartitionedQuery &query);
 void RegisterSemanticQueryFunctions(DatabaseInstance &instance);
+void RegisterBulkDatasetRegistrationFunctions(DatabaseInstance &instance);
+void RegisterSemanticRollupFunctions(DatabaseInstance &instance);
+void RegisterSemanticQueryBatchFunctions(DatabaseInstance &instance);
+void RegisterSemanticCalendarFunctions(DatabaseInstance &instance);
+void RegisterSemanticWarmupFunctions(DatabaseInstance &instance);
+void RegisterSemanticStatisticsFunctions(DatabaseInstance &instance);
 
 } // namespace duckdb
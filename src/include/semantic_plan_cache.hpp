@@ -0,0 +1,76 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/list.hpp"
+#include "duckdb/common/mutex.hpp"
+#include "duckdb/parser/query_node.hpp"
+
+namespace duckdb {
+
+struct SemanticQuery;
+
+struct SemanticPlanCacheStats {
+	idx_t hits = 0;
+	idx_t misses = 0;
+	idx_t evictions = 0;
+	idx_t invalidations = 0;
+	idx_t entries = 0;
+	idx_t capacity = 0;
+};
+
+//! LRU cache of compiled semantic queries, keyed by a canonical hash of the parsed SemanticQuery so that JSON key
+//! order and whitespace do not cause misses. Entries are invalidated per dataset when the dataset is re-registered,
+//! and every entry remembers the dataset version it was compiled against, so a plan compiled concurrently with a
+//! re-registration is never served for the new definition. Entries are also found by the exact JSON text they were
+//! compiled from, so that repeats of the same query text skip parsing and building the canonical key. Each
+//! DatasetRegistry owns one cache.
+class SemanticPlanCache {
+public:
+	static constexpr idx_t DEFAULT_CAPACITY = 1024;
+
+	//! Canonical key of a parsed semantic query, compiled with the given IN-list threshold
+	static string GetCacheKey(const SemanticQuery &query, idx_t in_list_threshold);
+
+	//! Returns a copy of the plan cached for this dataset version, or nullptr on a miss
+	unique_ptr<QueryNode> Lookup(const string &key, idx_t dataset_version);
+	//! Finds the canonical key and dataset of the entry compiled from exactly this query text, without counting a hit
+	//! or a miss - the plan itself is then looked up by its key
+	bool LookupText(const string &query_text, idx_t in_list_threshold, string &key, string &dataset);
+	//! An empty query_text caches a plan that is only found by its key
+	void Insert(const string &key, const string &query_text, idx_t in_list_threshold, const string &dataset,
+	            idx_t dataset_version, unique_ptr<QueryNode> plan);
+	void InvalidateDataset(const string &dataset);
+	//! Drops every entry, e.g. when a setting that compilation depends on changes
+	void InvalidateAll();
+	//! Changes the maximum number of entries, evicting the least recently used ones if needed. 0 disables caching.
+	void SetCapacity(idx_t capacity);
+	SemanticPlanCacheStats GetStats();
+
+private:
+	struct CacheEntry {
+		hash_t hash;
+		string key;
+		hash_t text_hash;
+		string text;
+		idx_t in_list_threshold;
+		string dataset;
+		idx_t dataset_version;
+		unique_ptr<QueryNode> plan;
+	};
+
+	static hash_t GetTextHash(const string &query_text, idx_t in_list_threshold);
+	void Erase(list<CacheEntry>::iterator entry);
+	void EvictToCapacity();
+
+	mutex lock;
+	idx_t capacity = DEFAULT_CAPACITY;
+	//! Most recently used entries first
+	list<CacheEntry> entries;
+	unordered_map<hash_t, list<CacheEntry>::iterator> index;
+	unordered_map<hash_t, list<CacheEntry>::iterator> text_index;
+	SemanticPlanCacheStats stats;
+};
+
+void RegisterSemanticPlanCacheFunctions(DatabaseInstance &instance);
+
+} // namespace duckdb
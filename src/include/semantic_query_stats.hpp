@@ -0,0 +1,62 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/mutex.hpp"
+#include "duckdb/common/profiler.hpp"
+
+namespace duckdb {
+
+//! Phases of binding a semantic query
+enum class SemanticQueryPhase : uint8_t { PARSE = 0, PLAN_CACHE_LOOKUP = 1, VALIDATE = 2, COMPILE = 3 };
+static constexpr idx_t SEMANTIC_QUERY_PHASE_COUNT = 4;
+
+//! Time spent (in seconds) in each phase of binding one semantic query
+struct SemanticQueryTimings {
+	double phases[SEMANTIC_QUERY_PHASE_COUNT] = {};
+	double total = 0;
+};
+
+//! Adds the time until it goes out of scope to one phase of the timings
+class SemanticPhaseTimer {
+public:
+	SemanticPhaseTimer(SemanticQueryTimings &timings, SemanticQueryPhase phase) : timings(timings), phase(phase) {
+		profiler.Start();
+	}
+	~SemanticPhaseTimer() {
+		profiler.End();
+		timings.phases[static_cast<idx_t>(phase)] += profiler.Elapsed();
+	}
+
+private:
+	SemanticQueryTimings &timings;
+	SemanticQueryPhase phase;
+	Profiler profiler;
+};
+
+struct SemanticDatasetQueryStats {
+	idx_t queries = 0;
+	idx_t plan_cache_hits = 0;
+	idx_t errors = 0;
+	//! Accumulated time per phase, in seconds
+	double phase_time[SEMANTIC_QUERY_PHASE_COUNT] = {};
+	double total_time = 0;
+	double max_time = 0;
+};
+
+//! Per-dataset counters and bind-time timers of semantic queries. Queries record their timings once, after binding,
+//! so the lock is taken once per query. Each DatasetRegistry owns one instance.
+class SemanticQueryStats {
+public:
+	//! Records one query - the dataset is empty for queries that failed before their dataset was known
+	void Record(const string &dataset, const SemanticQueryTimings &timings, bool plan_cache_hit, bool failed);
+	//! Current counters, ordered by dataset name
+	vector<pair<string, SemanticDatasetQueryStats>> GetStats();
+
+private:
+	mutex lock;
+	unordered_map<string, SemanticDatasetQueryStats> datasets;
+};
+
+void RegisterSemanticQueryStatsFunctions(DatabaseInstance &instance);
+
+} // namespace duckdb
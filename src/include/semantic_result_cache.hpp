@@ -0,0 +1,96 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/list.hpp"
+#include "duckdb/common/mutex.hpp"
+#include "duckdb/common/types/column/column_data_collection.hpp"
+
+#include <chrono>
+
+namespace duckdb {
+
+struct SemanticDataset;
+
+struct SemanticResultCacheStats {
+	idx_t hits = 0;
+	idx_t misses = 0;
+	idx_t evictions = 0;
+	idx_t invalidations = 0;
+	idx_t expirations = 0;
+	idx_t entries = 0;
+	idx_t memory_usage = 0;
+	idx_t memory_limit = 0;
+};
+
+//! The materialized output of one compiled semantic query
+struct SemanticCachedResult {
+	vector<string> names;
+	vector<LogicalType> types;
+	unique_ptr<ColumnDataCollection> collection;
+};
+
+//! LRU cache of semantic query results, bounded by the memory their collections allocate. Entries are keyed by the
+//! compiled SQL and remember the dataset version and the fingerprint of the source table they were computed from,
+//! so they are dropped when the dataset is re-registered, its rollups are refreshed or the source table changes.
+//! Entries also expire after the TTL of their dataset. Each DatasetRegistry owns one cache; it is disabled until a
+//! memory limit is set.
+class SemanticResultCache {
+public:
+	static constexpr idx_t DEFAULT_TTL_SECONDS = 300;
+
+	bool Enabled();
+	//! Returns the result cached for this dataset version and source fingerprint, or nullptr on a miss
+	shared_ptr<const SemanticCachedResult> Lookup(const string &key, idx_t dataset_version, const string &fingerprint);
+	void Insert(const string &key, const string &dataset, idx_t dataset_version, const string &fingerprint,
+	            idx_t ttl_seconds, shared_ptr<const SemanticCachedResult> result);
+	void InvalidateDataset(const string &dataset);
+	//! Changes the memory budget in bytes, evicting the least recently used entries if needed. 0 disables caching.
+	void SetMemoryLimit(idx_t memory_limit);
+	void SetDefaultTTL(idx_t ttl_seconds);
+	idx_t GetDefaultTTL();
+	SemanticResultCacheStats GetStats();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct CacheEntry {
+		hash_t hash;
+		string key;
+		string dataset;
+		idx_t dataset_version;
+		string fingerprint;
+		Clock::time_point expires_at;
+		idx_t size;
+		shared_ptr<const SemanticCachedResult> result;
+	};
+
+	void Erase(list<CacheEntry>::iterator entry);
+	void EvictToLimit();
+
+	mutex lock;
+	idx_t memory_limit = 0;
+	idx_t memory_usage = 0;
+	idx_t default_ttl = DEFAULT_TTL_SECONDS;
+	//! Most recently used entries first
+	list<CacheEntry> entries;
+	unordered_map<hash_t, list<CacheEntry>::iterator> index;
+	SemanticResultCacheStats stats;
+};
+
+//! Runs the compiled SQL of a semantic query through a separate connection, going through the result cache. The
+//! cached result is tied to the fingerprint of the rows of fingerprint_source ("<from> WHERE <condition>") if set,
+//! of the dataset's table otherwise, and to those of its joined and calendar tables.
+shared_ptr<const SemanticCachedResult> ExecuteCachedSemanticQuery(ClientContext &context,
+                                                                  const SemanticDataset &dataset, const string &sql,
+                                                                  const string &fingerprint_source = string());
+
+//! A scalar subquery whose value changes when rows are added to or removed from the table, or its refresh_key (an
+//! aggregate over the table, may be empty) changes
+string CompileTableFingerprintSQL(const string &table_name, const string &refresh_key);
+//! A connection to the database of the client for running semantic queries on the side, with the client's session
+//! settings that results depend on
+unique_ptr<Connection> MakeSemanticSideConnection(ClientContext &context);
+
+void RegisterSemanticResultCacheFunctions(DatabaseInstance &instance);
+
+} // namespace duckdb
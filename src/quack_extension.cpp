@@ -1,22 +1,28 @@
 #define DUCKDB_EXTENSION_MAIN
 
 #include "quack_extension.hpp"
+#include "semantic_plan_cache.hpp"
+#include "semantic_query_stats.hpp"
+#include "semantic_result_cache.hpp"
 #include "duckdb.hpp"
+#include "duckdb/common/error_data.hpp"
 #include "duckdb/common/exception.hpp"
+#include "duckdb/common/numeric_utils.hpp"
 #include "duckdb/common/string_util.hpp"
+#include "duckdb/common/vector_operations/vector_operations.hpp"
 #include "duckdb/function/scalar_function.hpp"
 #include "duckdb/function/table_function.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/main/connection.hpp"
 #include "duckdb/main/extension_util.hpp"
 #include "duckdb/parser/parsed_data/create_scalar_function_info.hpp"
 #include "duckdb/parser/parsed_data/create_table_function_info.hpp"
 #include "duckdb/planner/expression/bound_reference_expression.hpp"
 #include "duckdb/execution/expression_executor.hpp"
+#include "duckdb/parser/tableref/subqueryref.hpp"
 #include <duckdb/parser/statement/select_statement.hpp>
 #include <duckdb/parser/query_node/select_node.hpp>
 #include <duckdb/parser/tableref/basetableref.hpp>
-#ifdef HAVE_NLOHMANN_JSON
-#include <nlohmann/json.hpp>
-#endif
 
 // OpenSSL linked through vcpkg
 #include <openssl/opensslv.h>
@@ -24,400 +30,321 @@
 namespace duckdb {
 
 #ifdef HAVE_NLOHMANN_JSON
-using json = nlohmann::json;
-
-// Dataset Registry Implementation
-DatasetRegistry &DatasetRegistry::GetInstance() {
-	static DatasetRegistry instance;
-	return instance;
-}
-
-void DatasetRegistry::RegisterDataset(const string &name, const vector<SemanticMeasure> &measures,
-                                      const vector<SemanticDimension> &dimensions) {
-	dataset_measures_[name] = measures;
-	dataset_dimensions_[name] = dimensions;
-}
-
-bool DatasetRegistry::ValidateQuery(const SemanticQuery &query, string &error_msg) {
-	// Check if dataset exists
-	if (dataset_measures_.find(query.dataset) == dataset_measures_.end()) {
-		error_msg = "Dataset '" + query.dataset + "' not found in registry";
-		return false;
-	}
-
-	auto &measures = dataset_measures_[query.dataset];
-	auto &dimensions = dataset_dimensions_[query.dataset];
-
-	// Validate measures
-	for (const auto &measure_name : query.measures) {
-		bool found = false;
-		for (const auto &measure : measures) {
-			if (measure.name == measure_name) {
-				found = true;
-				break;
-			}
+unique_ptr<QueryNode> CompileCachedSemanticQuery(DatasetRegistry &registry, const string &query_json,
+                                                 string &dataset_name, shared_ptr<const SemanticDataset> &dataset,
+                                                 SemanticQueryTimings &timings, bool &plan_cache_hit) {
+	auto &plan_cache = registry.GetPlanCache();
+	// Read once, so that the plan and its cache key agree even if the setting changes concurrently
+	auto in_list_threshold = registry.GetInListThreshold();
+	string cache_key;
+	// Repeats of the exact query text are served without parsing it or building its canonical key
+	bool text_found;
+	{
+		SemanticPhaseTimer timer(timings, SemanticQueryPhase::PLAN_CACHE_LOOKUP);
+		text_found = plan_cache.LookupText(query_json, in_list_threshold, cache_key, dataset_name);
+		if (text_found) {
+			dataset = registry.GetDataset(dataset_name);
 		}
-		if (!found) {
-			error_msg = "Measure '" + measure_name + "' not found in dataset '" + query.dataset + "'";
-			return false;
+		if (dataset) {
+			auto cached_plan = plan_cache.Lookup(cache_key, dataset->version);
+			if (cached_plan) {
+				plan_cache_hit = true;
+				return cached_plan;
+			}
 		}
 	}
-
-	// Validate dimensions
-	for (const auto &dimension_name : query.dimensions) {
-		bool found = false;
-		for (const auto &dimension : dimensions) {
-			if (dimension.name == dimension_name) {
-				found = true;
-				break;
+	SemanticQuery semantic_query;
+	{
+		SemanticPhaseTimer timer(timings, SemanticQueryPhase::PARSE);
+		semantic_query = ParseSemanticQuery(query_json);
+		dataset_name = semantic_query.dataset;
+	}
+	{
+		SemanticPhaseTimer timer(timings, SemanticQueryPhase::PLAN_CACHE_LOOKUP);
+		cache_key = SemanticPlanCache::GetCacheKey(semantic_query, in_list_threshold);
+		dataset = registry.GetDataset(semantic_query.dataset);
+		// The same text has the same key, which was just looked up and missed
+		if (dataset && !text_found) {
+			auto cached_plan = plan_cache.Lookup(cache_key, dataset->version);
+			if (cached_plan) {
+				plan_cache_hit = true;
+				return cached_plan;
 			}
 		}
-		if (!found) {
-			error_msg = "Dimension '" + dimension_name + "' not found in dataset '" + query.dataset + "'";
-			return false;
-		}
 	}
 
-	// Validate time dimensions
-	for (const auto &time_dim : query.time_dimensions) {
-		bool found = false;
-		for (const auto &dimension : dimensions) {
-			if (dimension.name == time_dim.dimension) {
-				found = true;
-				break;
-			}
-		}
-		if (!found) {
-			error_msg = "Time dimension '" + time_dim.dimension + "' not found in dataset '" + query.dataset + "'";
-			return false;
+	BoundSemanticQuery bound_query;
+	{
+		SemanticPhaseTimer timer(timings, SemanticQueryPhase::VALIDATE);
+		string error_msg;
+		if (!registry.ValidateQuery(semantic_query, bound_query, error_msg)) {
+			throw InvalidInputException("Semantic query validation failed: " + error_msg);
 		}
+		bound_query.in_list_threshold = in_list_threshold;
 	}
-
-	return true;
-}
-
-const vector<SemanticMeasure> *DatasetRegistry::GetMeasures(const string &dataset_name) {
-	auto it = dataset_measures_.find(dataset_name);
-	return it != dataset_measures_.end() ? &it->second : nullptr;
+	SemanticPhaseTimer timer(timings, SemanticQueryPhase::COMPILE);
+	RouteSemanticQuery(semantic_query, bound_query);
+	auto plan = CompileSemanticQuery(semantic_query, bound_query);
+	plan_cache.Insert(cache_key, query_json, in_list_threshold, semantic_query.dataset, bound_query.dataset->version,
+	                  plan->Copy());
+	dataset = bound_query.dataset;
+	return std::move(plan);
 }
 
-const vector<SemanticDimension> *DatasetRegistry::GetDimensions(const string &dataset_name) {
-	auto it = dataset_dimensions_.find(dataset_name);
-	return it != dataset_dimensions_.end() ? &it->second : nullptr;
+unique_ptr<QueryNode> CompileCachedSemanticQuery(DatasetRegistry &registry, const SemanticQuery &semantic_query,
+                                                 BoundSemanticQuery &bound_query, bool &plan_cache_hit) {
+	auto &plan_cache = registry.GetPlanCache();
+	auto cache_key = SemanticPlanCache::GetCacheKey(semantic_query, bound_query.in_list_threshold);
+	auto cached_plan = plan_cache.Lookup(cache_key, bound_query.dataset->version);
+	if (cached_plan) {
+		plan_cache_hit = true;
+		return cached_plan;
+	}
+	RouteSemanticQuery(semantic_query, bound_query);
+	auto plan = CompileSemanticQuery(semantic_query, bound_query);
+	// There is no query text to find the plan by
+	plan_cache.Insert(cache_key, string(), bound_query.in_list_threshold, semantic_query.dataset,
+	                  bound_query.dataset->version, plan->Copy());
+	return std::move(plan);
 }
 
-// JSON Parsing Functions
-SemanticQuery ParseSemanticQuery(const string &json_str) {
-	SemanticQuery query;
-
+// Compiles a semantic query and records its bind-time timings and counters in semantic_query_stats()
+static unique_ptr<QueryNode> CompileSemanticQueryJSON(ClientContext &context, const string &query_json,
+                                                      shared_ptr<const SemanticDataset> *dataset_out = nullptr) {
+	string dataset_name;
+	shared_ptr<const SemanticDataset> dataset;
+	SemanticQueryTimings timings;
+	bool plan_cache_hit = false;
+	auto &registry = DatasetRegistry::Get(context);
+	auto &query_stats = registry.GetQueryStats();
+	Profiler profiler;
+	profiler.Start();
 	try {
-		json j = json::parse(json_str);
-
-		// Parse dataset
-		if (j.contains("dataset")) {
-			query.dataset = j["dataset"].get<string>();
+		auto plan = CompileCachedSemanticQuery(registry, query_json, dataset_name, dataset, timings, plan_cache_hit);
+		profiler.End();
+		timings.total = profiler.Elapsed();
+		query_stats.Record(dataset_name, timings, plan_cache_hit, false);
+		if (dataset_out) {
+			*dataset_out = std::move(dataset);
 		}
-
-		// Parse measures
-		if (j.contains("measures")) {
-			for (const auto &measure : j["measures"]) {
-				query.measures.push_back(measure.get<string>());
-			}
-		}
-
-		// Parse dimensions
-		if (j.contains("dimensions")) {
-			for (const auto &dimension : j["dimensions"]) {
-				query.dimensions.push_back(dimension.get<string>());
-			}
-		}
-
-		// Parse filters
-		if (j.contains("filters")) {
-			for (const auto &filter_json : j["filters"]) {
-				SemanticFilter filter;
-				filter.dimension = filter_json["dimension"].get<string>();
-				filter.operator_ = filter_json["operator"].get<string>();
-				for (const auto &value : filter_json["values"]) {
-					filter.values.push_back(value.get<string>());
-				}
-				query.filters.push_back(filter);
-			}
-		}
-
-		// Parse time_dimensions
-		if (j.contains("time_dimensions")) {
-			for (const auto &time_dim_json : j["time_dimensions"]) {
-				SemanticTimeDimension time_dim;
-				time_dim.dimension = time_dim_json["dimension"].get<string>();
-				if (time_dim_json.contains("granularity")) {
-					time_dim.granularity = time_dim_json["granularity"].get<string>();
-				}
-				if (time_dim_json.contains("date_range")) {
-					for (const auto &date : time_dim_json["date_range"]) {
-						time_dim.date_range.push_back(date.get<string>());
-					}
-				}
-				query.time_dimensions.push_back(time_dim);
-			}
-		}
-
-		// Parse order
-		if (j.contains("order")) {
-			for (const auto &order_json : j["order"]) {
-				SemanticOrder order;
-				order.id = order_json["id"].get<string>();
-				order.desc = order_json.contains("desc") ? order_json["desc"].get<bool>() : false;
-				query.order.push_back(order);
-			}
-		}
-
-		// Parse limit
-		if (j.contains("limit")) {
-			query.limit = j["limit"].get<int64_t>();
-		} else {
-			query.limit = -1; // No limit
-		}
-
-		// Parse time_zone
-		if (j.contains("time_zone")) {
-			query.time_zone = j["time_zone"].get<string>();
-		}
-
-	} catch (const json::exception &e) {
-		throw InvalidInputException("Invalid JSON in semantic query: " + string(e.what()));
+		return plan;
+	} catch (...) {
+		profiler.End();
+		timings.total = profiler.Elapsed();
+		query_stats.Record(dataset_name, timings, plan_cache_hit, true);
+		throw;
 	}
-
-	return query;
 }
 
-// SQL Compilation Function
-string CompileSemanticQueryToSQL(const SemanticQuery &query) {
-	string sql = "SELECT ";
-
-	auto &registry = DatasetRegistry::GetInstance();
-	auto measures = registry.GetMeasures(query.dataset);
-	auto dimensions = registry.GetDimensions(query.dataset);
-
-	if (!measures || !dimensions) {
-		throw InvalidInputException("Dataset '" + query.dataset + "' not found in registry");
-	}
-
-	vector<string> select_list;
-
-	// Add measures
-	for (const auto &measure_name : query.measures) {
-		for (const auto &measure : *measures) {
-			if (measure.name == measure_name) {
-				select_list.push_back(measure.sql_expression + " AS " + measure.name);
-				break;
-			}
-		}
-	}
-
-	// Add dimensions
-	for (const auto &dimension_name : query.dimensions) {
-		for (const auto &dimension : *dimensions) {
-			if (dimension.name == dimension_name) {
-				select_list.push_back(dimension.sql_expression + " AS " + dimension.name);
-				break;
-			}
-		}
-	}
-
-	// Add time dimensions with granularity
-	for (const auto &time_dim : query.time_dimensions) {
-		for (const auto &dimension : *dimensions) {
-			if (dimension.name == time_dim.dimension) {
-				string time_expr = dimension.sql_expression;
-				if (!time_dim.granularity.empty()) {
-					if (time_dim.granularity == "day") {
-						time_expr = "DATE_TRUNC('day', " + time_expr + ")";
-					} else if (time_dim.granularity == "month") {
-						time_expr = "DATE_TRUNC('month', " + time_expr + ")";
-					} else if (time_dim.granularity == "year") {
-						time_expr = "DATE_TRUNC('year', " + time_expr + ")";
-					}
-				}
-				select_list.push_back(time_expr + " AS " + time_dim.dimension);
-				break;
-			}
-		}
+static bool IsExplainMode(const TableFunctionBindInput &input) {
+	// Check if second parameter indicates explain mode
+	if (input.inputs.size() > 1 && input.inputs[1].type() == LogicalType::BOOLEAN) {
+		return input.inputs[1].GetValue<bool>();
 	}
+	return false;
+}
 
-	if (select_list.empty()) {
-		throw InvalidInputException("No valid measures or dimensions specified");
+// Granularity of the partitions a query is split into (see CompilePartitionedSemanticQuery), empty if not partitioned
+static string GetPartitionGranularity(const TableFunctionBindInput &input) {
+	auto entry = input.named_parameters.find("partition_by");
+	if (entry == input.named_parameters.end() || entry->second.IsNull()) {
+		return string();
 	}
+	return entry->second.GetValue<string>();
+}
 
-	sql += StringUtil::Join(select_list, ", ");
-	sql += " FROM " + query.dataset;
-
-	// Add WHERE clause
-	vector<string> where_conditions;
-
-	// Add regular filters
-	for (const auto &filter : query.filters) {
-		if (filter.operator_ == "equals") {
-			if (filter.values.size() == 1) {
-				where_conditions.push_back(filter.dimension + " = '" + filter.values[0] + "'");
-			} else if (filter.values.size() > 1) {
-				vector<string> quoted_values;
-				for (const auto &value : filter.values) {
-					quoted_values.push_back("'" + value + "'");
-				}
-				where_conditions.push_back(filter.dimension + " IN (" + StringUtil::Join(quoted_values, ", ") + ")");
-			}
-		} else if (filter.operator_ == "not_equals") {
-			if (filter.values.size() == 1) {
-				where_conditions.push_back(filter.dimension + " != '" + filter.values[0] + "'");
-			} else if (filter.values.size() > 1) {
-				vector<string> quoted_values;
-				for (const auto &value : filter.values) {
-					quoted_values.push_back("'" + value + "'");
-				}
-				where_conditions.push_back(filter.dimension + " NOT IN (" + StringUtil::Join(quoted_values, ", ") +
-				                           ")");
-			}
-		}
-	}
+// Results are only cached for queries that run outside of an explicit transaction - the cached query runs on a
+// separate connection, which would not see the transaction's own changes
+static bool UseResultCache(ClientContext &context) {
+	return DatasetRegistry::Get(context).GetResultCache().Enabled() && context.transaction.IsAutoCommit();
+}
 
-	// Add time dimension filters
-	for (const auto &time_dim : query.time_dimensions) {
-		if (time_dim.date_range.size() == 2) {
-			where_conditions.push_back(time_dim.dimension + " >= '" + time_dim.date_range[0] + "'");
-			where_conditions.push_back(time_dim.dimension + " <= '" + time_dim.date_range[1] + "'");
-		}
-	}
+// Table Function Data Structure (explain mode, cached and partitioned results - other queries are replaced at bind
+// time)
+struct SemanticQueryData : public TableFunctionData {
+	//! The compiled SQL, returned in explain mode - one row per partition for a partitioned query
+	vector<string> compiled_sql;
+	//! The dataset and compiled SQL of a query that goes through the result cache when it is executed
+	shared_ptr<const SemanticDataset> dataset;
+	string sql;
+	//! A partitioned query, run and merged when it is executed
+	unique_ptr<SemanticPartitionedQuery> partitioned;
+	//! The result types the query was bound with
+	vector<LogicalType> return_types;
+};
 
-	if (!where_conditions.empty()) {
-		sql += " WHERE " + StringUtil::Join(where_conditions, " AND ");
-	}
+struct SemanticQueryGlobalState : public GlobalTableFunctionState {
+	//! Position of the next compiled SQL row to return in explain mode
+	idx_t offset = 0;
+	shared_ptr<const SemanticCachedResult> result;
+	ColumnDataScanState scan_state;
+	//! The chunks of a result whose types differ from those the query was bound with, before they are cast
+	DataChunk scan_chunk;
+};
 
-	// Add GROUP BY clause (if we have measures)
-	if (!query.measures.empty()) {
-		vector<string> group_by_list;
-		for (const auto &dimension_name : query.dimensions) {
-			group_by_list.push_back(dimension_name);
-		}
-		for (const auto &time_dim : query.time_dimensions) {
-			group_by_list.push_back(time_dim.dimension);
-		}
-		if (!group_by_list.empty()) {
-			sql += " GROUP BY " + StringUtil::Join(group_by_list, ", ");
-		}
+// The result types of the SQL, from preparing it on a separate connection - it is not run
+static void BindSemanticQueryTypes(ClientContext &context, const string &sql, vector<LogicalType> &return_types,
+                                   vector<string> &names) {
+	auto con = MakeSemanticSideConnection(context);
+	auto prepared = con->Prepare(sql);
+	if (prepared->HasError()) {
+		throw InvalidInputException("Semantic query failed to bind: %s", prepared->GetError());
 	}
+	return_types = prepared->GetTypes();
+	names = prepared->GetNames();
+}
 
-	// Add ORDER BY clause
-	if (!query.order.empty()) {
-		vector<string> order_list;
-		for (const auto &order : query.order) {
-			string order_clause = order.id;
-			if (order.desc) {
-				order_clause += " DESC";
-			}
-			order_list.push_back(order_clause);
-		}
-		sql += " ORDER BY " + StringUtil::Join(order_list, ", ");
+// Table Function Implementation
+// Regular (non-explain) queries substitute the compiled SELECT statement for the table function, the way a view is
+// expanded. The semantic query then becomes part of the outer plan, so it is optimized and executed in parallel
+// together with it, and outer filters and projections are pushed into it.
+static unique_ptr<TableRef> SemanticQueryBindReplace(ClientContext &context, TableFunctionBindInput &input) {
+	if (input.inputs.empty()) {
+		throw InvalidInputException("SEMANTIC_QUERY requires at least one argument (JSON query)");
 	}
-
-	// Add LIMIT clause
-	if (query.limit > 0) {
-		sql += " LIMIT " + to_string(query.limit);
+	if (IsExplainMode(input) || UseResultCache(context) || !GetPartitionGranularity(input).empty()) {
+		// Fall back to the regular bind, which returns the compiled SQL, the cached result or the merged partitions
+		return nullptr;
 	}
 
-	return sql;
+	auto select_stmt = make_uniq<SelectStatement>();
+	select_stmt->node = CompileSemanticQueryJSON(context, input.inputs[0].GetValue<string>());
+	return make_uniq<SubqueryRef>(std::move(select_stmt));
 }
 
-// Table Function Data Structure
-struct SemanticQueryData : public TableFunctionData {
-	string query_json;
-	string compiled_sql;
-	bool explained;
-	bool finished;
-
-	SemanticQueryData(string json, bool explain = false) : query_json(json), explained(explain), finished(false) {
-		auto semantic_query = ParseSemanticQuery(json);
-		string error_msg;
-		if (!DatasetRegistry::GetInstance().ValidateQuery(semantic_query, error_msg)) {
-			throw InvalidInputException("Semantic query validation failed: " + error_msg);
-		}
-		compiled_sql = CompileSemanticQueryToSQL(semantic_query);
-	}
-};
-
-// Table Function Implementation
 static unique_ptr<FunctionData> SemanticQueryBind(ClientContext &context, TableFunctionBindInput &input,
                                                   vector<LogicalType> &return_types, vector<string> &names) {
 	if (input.inputs.empty()) {
 		throw InvalidInputException("SEMANTIC_QUERY requires at least one argument (JSON query)");
 	}
 
-	bool explain_mode = false;
-	if (input.inputs.size() > 1) {
-		// Check if second parameter indicates explain mode
-		if (input.inputs[1].type() == LogicalType::BOOLEAN) {
-			explain_mode = input.inputs[1].GetValue<bool>();
+	auto data = make_uniq<SemanticQueryData>();
+	auto partition_granularity = GetPartitionGranularity(input);
+	if (!partition_granularity.empty()) {
+		auto partitioned =
+		    CompilePartitionedSemanticQuery(context, input.inputs[0].GetValue<string>(), partition_granularity);
+		if (IsExplainMode(input)) {
+			data->compiled_sql = partitioned.partitions;
+			return_types = {LogicalType::VARCHAR};
+			names = {"compiled_sql"};
+			return std::move(data);
 		}
+		return_types = partitioned.types;
+		names = partitioned.names;
+		data->return_types = return_types;
+		data->partitioned = make_uniq<SemanticPartitionedQuery>(std::move(partitioned));
+		return std::move(data);
 	}
-
-	string query_json = input.inputs[0].GetValue<string>();
-	auto data = make_uniq<SemanticQueryData>(query_json, explain_mode);
-
-	if (explain_mode) {
-		// For EXPLAIN mode, return the compiled SQL
-		return_types = {LogicalType::VARCHAR};
-		names = {"compiled_sql"};
-	} else {
-		// For normal mode, return a simplified schema
-		// In production, this would be dynamically determined from the query
-		return_types = {LogicalType::VARCHAR, LogicalType::BIGINT, LogicalType::DATE};
-		names = {"result", "count", "date"};
+	if (!IsExplainMode(input)) {
+		// Only bound here - the cached result is looked up when the query is executed, so that every EXECUTE of a
+		// prepared statement sees the current data, and DESCRIBE or EXPLAIN never run it
+		data->sql = CompileSemanticQueryJSON(context, input.inputs[0].GetValue<string>(), &data->dataset)->ToString();
+		BindSemanticQueryTypes(context, data->sql, return_types, names);
+		data->return_types = return_types;
+		return std::move(data);
 	}
 
+	// For EXPLAIN mode, return the compiled SQL
+	data->compiled_sql.push_back(CompileSemanticQueryJSON(context, input.inputs[0].GetValue<string>())->ToString());
+	return_types = {LogicalType::VARCHAR};
+	names = {"compiled_sql"};
 	return std::move(data);
 }
 
-static void SemanticQueryFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
-	auto &data = (SemanticQueryData &)*data_p.bind_data;
+static unique_ptr<GlobalTableFunctionState> SemanticQueryInit(ClientContext &context, TableFunctionInitInput &input) {
+	auto &data = input.bind_data->Cast<SemanticQueryData>();
+	auto result = make_uniq<SemanticQueryGlobalState>();
+	if (data.partitioned) {
+		result->result = ExecutePartitionedSemanticQuery(context, *data.partitioned);
+	} else if (!data.sql.empty()) {
+		result->result = ExecuteCachedSemanticQuery(context, *data.dataset, data.sql);
+	}
+	if (result->result) {
+		auto &types = result->result->types;
+		if (types.size() != data.return_types.size()) {
+			throw InvalidInputException("The columns of the semantic query changed since it was bound");
+		}
+		if (types != data.return_types) {
+			// A result cached under an older schema of the source, which the statement was bound again for
+			result->scan_chunk.Initialize(context, types);
+		}
+		result->result->collection->InitializeScan(result->scan_state);
+	}
+	return std::move(result);
+}
 
-	// If already finished, return empty chunk
-	if (data.finished) {
-		output.SetCardinality(0);
+static void SemanticQueryFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->Cast<SemanticQueryData>();
+	auto &state = data_p.global_state->Cast<SemanticQueryGlobalState>();
+	if (state.result) {
+		// Stream the cached chunks
+		if (state.scan_chunk.ColumnCount() == 0) {
+			state.result->collection->Scan(state.scan_state, output);
+			return;
+		}
+		state.scan_chunk.Reset();
+		state.result->collection->Scan(state.scan_state, state.scan_chunk);
+		for (idx_t col = 0; col < output.ColumnCount(); col++) {
+			VectorOperations::Cast(context, state.scan_chunk.data[col], output.data[col], state.scan_chunk.size());
+		}
+		output.SetCardinality(state.scan_chunk.size());
 		return;
 	}
 
-	if (data.explained) {
-		// Return the compiled SQL for explain mode
-		output.SetCardinality(1);
-		output.SetValue(0, 0, Value(data.compiled_sql));
-		data.finished = true;
-	} else {
-		// For normal mode, return a placeholder result showing the compiled SQL
-		// In a production implementation, this would execute the SQL and return actual data
-		output.SetCardinality(1);
-		output.SetValue(0, 0, Value("Compiled SQL: " + data.compiled_sql));
-		output.SetValue(1, 0, Value::BIGINT(1));
-		output.SetValue(2, 0, Value::DATE(Date::FromString("2025-01-01")));
-		data.finished = true;
+	// Return the compiled SQL for explain mode
+	idx_t count = 0;
+	while (state.offset < data.compiled_sql.size() && count < STANDARD_VECTOR_SIZE) {
+		output.SetValue(0, count++, Value(data.compiled_sql[state.offset++]));
 	}
+	output.SetCardinality(count);
 }
 
 #endif // HAVE_NLOHMANN_JSON
 
 // Scalar Functions (existing)
+// The greetings are the name between a constant prefix and suffix. They are written straight into the string heap of
+// the result, and computed once per value of constant and dictionary vectors.
+static constexpr const char QUACK_PREFIX[] = "Quack ";
+static constexpr const char QUACK_SUFFIX[] = " 🐥";
+static constexpr const char QUACK_OPENSSL_SUFFIX[] = ", my linked OpenSSL version is " OPENSSL_VERSION_TEXT;
+
+template <size_t SUFFIX_SIZE>
+static void QuackGreetingFun(DataChunk &args, Vector &result, const char (&suffix)[SUFFIX_SIZE]) {
+	static constexpr idx_t PREFIX_LENGTH = sizeof(QUACK_PREFIX) - 1;
+	static constexpr idx_t SUFFIX_LENGTH = SUFFIX_SIZE - 1;
+	auto greet = [&](Vector &names, Vector &target, idx_t count) {
+		UnaryExecutor::Execute<string_t, string_t>(names, target, count, [&](string_t name) {
+			auto name_length = name.GetSize();
+			auto greeting = StringVector::EmptyString(target, PREFIX_LENGTH + name_length + SUFFIX_LENGTH);
+			auto data = greeting.GetDataWriteable();
+			memcpy(data, QUACK_PREFIX, PREFIX_LENGTH);
+			memcpy(data + PREFIX_LENGTH, name.GetData(), name_length);
+			memcpy(data + PREFIX_LENGTH + name_length, suffix, SUFFIX_LENGTH);
+			greeting.Finalize();
+			return greeting;
+		});
+	};
+	auto &names = args.data[0];
+	if (names.GetVectorType() == VectorType::DICTIONARY_VECTOR) {
+		auto dictionary_size = DictionaryVector::DictionarySize(names);
+		if (dictionary_size.IsValid() && dictionary_size.GetIndex() < args.size()) {
+			// Greet every dictionary entry once and select from the greetings like the input does
+			Vector greetings(LogicalType::VARCHAR, dictionary_size.GetIndex());
+			greet(DictionaryVector::Child(names), greetings, dictionary_size.GetIndex());
+			result.Slice(greetings, DictionaryVector::SelVector(names), args.size());
+			return;
+		}
+	}
+	// Constant vectors are greeted once by the executor
+	greet(names, result, args.size());
+}
+
 inline void QuackScalarFun(DataChunk &args, ExpressionState &state, Vector &result) {
-	auto &name_vector = args.data[0];
-	UnaryExecutor::Execute<string_t, string_t>(name_vector, result, args.size(), [&](string_t name) {
-		return StringVector::AddString(result, "Quack " + name.GetString() + " 🐥");
-	});
+	QuackGreetingFun(args, result, QUACK_SUFFIX);
 }
 
 inline void QuackOpenSSLVersionScalarFun(DataChunk &args, ExpressionState &state, Vector &result) {
-	auto &name_vector = args.data[0];
-	UnaryExecutor::Execute<string_t, string_t>(name_vector, result, args.size(), [&](string_t name) {
-		return StringVector::AddString(result, "Quack " + name.GetString() + ", my linked OpenSSL version is " +
-		                                           OPENSSL_VERSION_TEXT);
-	});
+	QuackGreetingFun(args, result, QUACK_OPENSSL_SUFFIX);
 }
 
 // Dataset Registration Function
@@ -429,68 +356,58 @@ inline void RegisterDatasetScalarFun(DataChunk &args, ExpressionState &state, Ve
 	    dataset_name_vector, dataset_json_vector, result, args.size(),
 	    [&](string_t dataset_name, string_t dataset_json) {
 		    try {
-			    // Parse the complete dataset JSON
-			    json dataset_j = json::parse(dataset_json.GetString());
-
-			    // Parse measures
-			    vector<SemanticMeasure> measures;
-			    if (dataset_j.contains("measures")) {
-				    for (const auto &measure_json : dataset_j["measures"]) {
-					    SemanticMeasure measure;
-					    measure.name = measure_json["name"].get<string>();
-					    measure.aggregation_type =
-					        measure_json.contains("type") ? measure_json["type"].get<string>() : "sum";
-					    measure.sql_expression = measure_json["sql"].get<string>();
-					    measures.push_back(measure);
-				    }
-			    }
-
-			    // Parse dimensions
-			    vector<SemanticDimension> dimensions;
-			    if (dataset_j.contains("dimensions")) {
-				    for (const auto &dimension_json : dataset_j["dimensions"]) {
-					    SemanticDimension dimension;
-					    dimension.name = dimension_json["name"].get<string>();
-					    dimension.sql_expression = dimension_json["sql"].get<string>();
-					    dimension.data_type = LogicalType::VARCHAR; // Simplified
-					    dimensions.push_back(dimension);
-				    }
-			    }
-
-			    // Parse time_dimensions
-			    if (dataset_j.contains("time_dimensions")) {
-				    for (const auto &time_dim_json : dataset_j["time_dimensions"]) {
-					    SemanticDimension dimension;
-					    dimension.name = time_dim_json["name"].get<string>();
-					    dimension.sql_expression = time_dim_json["sql"].get<string>();
-					    dimension.data_type = LogicalType::DATE; // Time dimensions are date type
-					    dimensions.push_back(dimension);
-				    }
-			    }
-
-			    // Register the dataset
-			    DatasetRegistry::GetInstance().RegisterDataset(dataset_name.GetString(), measures, dimensions);
+			    auto &context = state.GetContext();
+			    auto dataset = ParseSemanticDataset(dataset_name.GetString(), dataset_json.GetString());
+			    DatasetRegistry::Get(context).RegisterDataset(*context.db, std::move(dataset));
 
 			    return StringVector::AddString(result,
 			                                   "Dataset '" + dataset_name.GetString() + "' registered successfully");
 		    } catch (const std::exception &e) {
-			    throw InvalidInputException("Failed to register dataset: " + string(e.what()));
+			    ErrorData error(e);
+			    throw InvalidInputException("Failed to register dataset: " + error.Message());
 		    }
 	    });
 }
 
+static void SetSemanticInListThreshold(ClientContext &context, SetScope scope, Value &parameter) {
+	auto threshold = parameter.GetValue<int64_t>();
+	if (threshold < 0) {
+		throw InvalidInputException("semantic_in_list_threshold must be non-negative");
+	}
+	DatasetRegistry::Get(context).SetInListThreshold(NumericCast<idx_t>(threshold));
+}
+
 void RegisterSemanticQueryFunctions(DatabaseInstance &instance) {
 #ifdef HAVE_NLOHMANN_JSON
+	auto &config = DBConfig::GetConfig(instance);
+	config.AddExtensionOption("semantic_in_list_threshold",
+	                          "Filters with more values than this are compiled to a semi-join against a list of the "
+	                          "values instead of an IN list",
+	                          LogicalType::BIGINT, Value::BIGINT(DatasetRegistry::DEFAULT_IN_LIST_THRESHOLD),
+	                          SetSemanticInListThreshold);
+
 	// Register the table function
 	TableFunction semantic_query_func("SEMANTIC_QUERY", {LogicalType::VARCHAR}, SemanticQueryFunction,
-	                                  SemanticQueryBind);
+	                                  SemanticQueryBind, SemanticQueryInit);
+	semantic_query_func.bind_replace = SemanticQueryBindReplace;
 	semantic_query_func.varargs = LogicalType::ANY;
+	semantic_query_func.named_parameters["partition_by"] = LogicalType::VARCHAR;
 	ExtensionUtil::RegisterFunction(instance, semantic_query_func);
 
 	// Register dataset registration function
 	auto register_dataset_function = ScalarFunction("REGISTER_DATASET", {LogicalType::VARCHAR, LogicalType::VARCHAR},
 	                                                LogicalType::VARCHAR, RegisterDatasetScalarFun);
 	ExtensionUtil::RegisterFunction(instance, register_dataset_function);
+
+	RegisterBulkDatasetRegistrationFunctions(instance);
+	RegisterSemanticRollupFunctions(instance);
+	RegisterSemanticQueryBatchFunctions(instance);
+	RegisterSemanticCalendarFunctions(instance);
+	RegisterSemanticPlanCacheFunctions(instance);
+	RegisterSemanticQueryStatsFunctions(instance);
+	RegisterSemanticResultCacheFunctions(instance);
+	RegisterSemanticWarmupFunctions(instance);
+	RegisterSemanticStatisticsFunctions(instance);
 #else
 	// Semantic query functionality is disabled - nlohmann_json not available
 	(void)instance; // Suppress unused parameter warning
@@ -508,6 +425,10 @@ static void LoadInternal(DatabaseInstance &instance) {
 
 	// Register semantic query functions
 	RegisterSemanticQueryFunctions(instance);
+#ifdef HAVE_NLOHMANN_JSON
+	// Bring back the datasets registered in this database before it was (re)opened
+	DatasetRegistry::Get(instance).LoadPersistedDatasets(instance);
+#endif
 }
 
 void QuackExtension::Load(DuckDB &db) {
@@ -0,0 +1,884 @@
+#include "quack_extension.hpp"
+#include "semantic_plan_cache.hpp"
+#include "semantic_result_cache.hpp"
+#include "duckdb/common/error_data.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/common/profiler.hpp"
+#include "duckdb/common/types/column/column_data_collection.hpp"
+#include "duckdb/common/vector_operations/vector_operations.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/connection.hpp"
+#include "duckdb/main/extension_util.hpp"
+#include "duckdb/parallel/task_executor.hpp"
+#include "duckdb/parser/expression/case_expression.hpp"
+#include "duckdb/parser/expression/columnref_expression.hpp"
+#include "duckdb/parser/expression/comparison_expression.hpp"
+#include "duckdb/parser/expression/constant_expression.hpp"
+#include "duckdb/parser/expression/operator_expression.hpp"
+#include "duckdb/parser/expression/star_expression.hpp"
+#include "duckdb/parser/query_node/select_node.hpp"
+#include "duckdb/parser/query_node/set_operation_node.hpp"
+#include "duckdb/parser/statement/select_statement.hpp"
+#include "duckdb/parser/tableref/expressionlistref.hpp"
+#include "duckdb/parser/tableref/joinref.hpp"
+#include "duckdb/parser/tableref/subqueryref.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+// GROUPING() returns one bit per argument, so a group can only share a scan over this many dimensions
+static constexpr idx_t MAX_GROUP_DIMENSIONS = 62;
+
+// Queries can share a scan when they aggregate, and when their rows need no per-query ORDER BY or LIMIT
+static bool IsShareable(const SemanticQuery &query) {
+	if (query.measures.empty() || !query.order.empty() || query.limit > 0) {
+		return false;
+	}
+	// The shared scan has one column per member name
+	for (auto &time_dim : query.time_dimensions) {
+		if (std::find(query.dimensions.begin(), query.dimensions.end(), time_dim.dimension) !=
+		    query.dimensions.end()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Queries with the same dataset, filters and time dimensions share a scan - they only differ in their members
+static string GetGroupKey(const SemanticQuery &query, idx_t in_list_threshold) {
+	SemanticQuery scan;
+	scan.dataset = query.dataset;
+	scan.filters = query.filters;
+	scan.time_dimensions = query.time_dimensions;
+	scan.limit = -1;
+	scan.time_zone = query.time_zone;
+	return SemanticPlanCache::GetCacheKey(scan, in_list_threshold);
+}
+
+static void AddUnique(vector<idx_t> &indexes, const vector<idx_t> &new_indexes) {
+	for (auto index : new_indexes) {
+		if (std::find(indexes.begin(), indexes.end(), index) == indexes.end()) {
+			indexes.push_back(index);
+		}
+	}
+}
+
+//! GROUPING() over the group's dimensions has a bit set for every dimension the query does not group by
+static idx_t GetGroupingId(const SemanticQueryGroup &group, const BoundSemanticQuery &bound) {
+	idx_t grouping_id = 0;
+	for (idx_t i = 0; i < group.dimensions.size(); i++) {
+		if (std::find(bound.dimensions.begin(), bound.dimensions.end(), group.dimensions[i]) ==
+		    bound.dimensions.end()) {
+			grouping_id |= idx_t(1) << (group.dimensions.size() - 1 - i);
+		}
+	}
+	return grouping_id;
+}
+
+static unique_ptr<SubqueryRef> MakeSubqueryRef(unique_ptr<QueryNode> node, const string &alias) {
+	auto select_stmt = make_uniq<SelectStatement>();
+	select_stmt->node = std::move(node);
+	return make_uniq<SubqueryRef>(std::move(select_stmt), alias);
+}
+
+// The shared scan, joined with the query indexes of its grouping sets - a grouping set that several queries ask
+// for is computed once and returned for each of them. Measures are NULL for the queries that did not ask for them.
+//   SELECT __batch.query_index, <members> FROM (<group>) AS __shared
+//   JOIN (VALUES (<grouping id>, <query index>), ...) AS __batch(__grouping_id, query_index)
+//   ON __shared.__grouping_id = __batch.__grouping_id
+static unique_ptr<QueryNode> CompileSharedScan(const vector<SemanticQuery> &queries,
+                                               const vector<BoundSemanticQuery> &bound,
+                                               const SemanticQueryGroup &group) {
+	auto &dataset = *bound[group.queries[0]].dataset;
+	auto node = make_uniq<SelectNode>();
+	node->select_list.push_back(make_uniq<ColumnRefExpression>("query_index", "__batch"));
+	for (auto measure_idx : group.measures) {
+		auto &name = dataset.measures[measure_idx].name;
+		auto requested_by = make_uniq<OperatorExpression>(ExpressionType::COMPARE_IN);
+		requested_by->children.push_back(make_uniq<ColumnRefExpression>("query_index", "__batch"));
+		for (auto query_idx : group.queries) {
+			auto &measures = bound[query_idx].measures;
+			if (std::find(measures.begin(), measures.end(), measure_idx) != measures.end()) {
+				requested_by->children.push_back(
+				    make_uniq<ConstantExpression>(Value::INTEGER(NumericCast<int32_t>(query_idx))));
+			}
+		}
+		auto column = make_uniq_base<ParsedExpression, ColumnRefExpression>(name, "__shared");
+		if (requested_by->children.size() == group.queries.size() + 1) {
+			node->select_list.push_back(std::move(column));
+			continue;
+		}
+		auto case_expr = make_uniq<CaseExpression>();
+		CaseCheck check;
+		check.when_expr = std::move(requested_by);
+		check.then_expr = std::move(column);
+		case_expr->case_checks.push_back(std::move(check));
+		case_expr->else_expr = make_uniq<ConstantExpression>(Value());
+		case_expr->SetAlias(name);
+		node->select_list.push_back(std::move(case_expr));
+	}
+	for (auto dimension_idx : group.dimensions) {
+		node->select_list.push_back(make_uniq<ColumnRefExpression>(dataset.dimensions[dimension_idx].name, "__shared"));
+	}
+	for (auto &time_dim : queries[group.queries[0]].time_dimensions) {
+		node->select_list.push_back(make_uniq<ColumnRefExpression>(time_dim.dimension, "__shared"));
+	}
+
+	auto query_indexes = make_uniq<ExpressionListRef>();
+	for (auto query_idx : group.queries) {
+		vector<unique_ptr<ParsedExpression>> row;
+		auto grouping_id = GetGroupingId(group, bound[query_idx]);
+		row.push_back(make_uniq<ConstantExpression>(Value::BIGINT(NumericCast<int64_t>(grouping_id))));
+		row.push_back(make_uniq<ConstantExpression>(Value::INTEGER(NumericCast<int32_t>(query_idx))));
+		query_indexes->values.push_back(std::move(row));
+	}
+	// A VALUES list in FROM, as the parser produces it
+	auto values_node = make_uniq<SelectNode>();
+	values_node->select_list.push_back(make_uniq<StarExpression>());
+	values_node->from_table = std::move(query_indexes);
+	auto batch_ref = MakeSubqueryRef(std::move(values_node), "__batch");
+	batch_ref->column_name_alias = {"__grouping_id", "query_index"};
+
+	auto join = make_uniq<JoinRef>(JoinRefType::REGULAR);
+	join->type = JoinType::INNER;
+	join->left = MakeSubqueryRef(CompileSemanticQueryGroup(queries, bound, group), "__shared");
+	join->right = std::move(batch_ref);
+	join->condition = make_uniq<ComparisonExpression>(ExpressionType::COMPARE_EQUAL,
+	                                                  make_uniq<ColumnRefExpression>("__grouping_id", "__shared"),
+	                                                  make_uniq<ColumnRefExpression>("__grouping_id", "__batch"));
+	node->from_table = std::move(join);
+	return std::move(node);
+}
+
+// A query that runs on its own keeps its ORDER BY and LIMIT, and can be answered from a rollup. Its plan comes from
+// the plan cache, like that of SEMANTIC_QUERY.
+//   SELECT <query index> AS query_index, * FROM (<query>) AS __query
+static unique_ptr<QueryNode> CompileSingleQuery(DatasetRegistry &registry, const SemanticQuery &query,
+                                                BoundSemanticQuery &bound, idx_t query_idx, bool &plan_cache_hit) {
+	auto node = make_uniq<SelectNode>();
+	node->select_list.push_back(make_uniq<ConstantExpression>(Value::INTEGER(NumericCast<int32_t>(query_idx))));
+	node->select_list.back()->SetAlias("query_index");
+	node->select_list.push_back(make_uniq<StarExpression>());
+	node->from_table =
+	    MakeSubqueryRef(CompileCachedSemanticQuery(registry, query, bound, plan_cache_hit), "__query");
+	return std::move(node);
+}
+
+static vector<SemanticQuery> ParseAndValidateBatch(ClientContext &context, const string &batch_json,
+                                                   vector<BoundSemanticQuery> &bound) {
+	auto queries = ParseSemanticQueryBatch(batch_json);
+	if (queries.empty()) {
+		throw InvalidInputException("semantic_query_batch requires at least one query");
+	}
+	auto &registry = DatasetRegistry::Get(context);
+	auto in_list_threshold = registry.GetInListThreshold();
+	bound.resize(queries.size());
+	for (idx_t i = 0; i < queries.size(); i++) {
+		string error_msg;
+		if (!registry.ValidateQuery(queries[i], bound[i], error_msg)) {
+			throw InvalidInputException("Semantic query %d of the batch failed validation: %s", i, error_msg);
+		}
+		bound[i].in_list_threshold = in_list_threshold;
+	}
+	return queries;
+}
+
+// Compiles a batch of validated queries into one statement: the UNION ALL BY NAME of one shared scan per group of
+// queries (and of the queries that cannot share a scan). Columns that a part does not produce are NULL in its rows.
+// plan_cache_hits tells for each query whether its plan came from the plan cache.
+static unique_ptr<QueryNode> CompileValidatedBatch(DatasetRegistry &registry, const vector<SemanticQuery> &queries,
+                                                   vector<BoundSemanticQuery> &bound, vector<bool> &plan_cache_hits) {
+	D_ASSERT(!queries.empty() && queries.size() == bound.size());
+	plan_cache_hits.assign(queries.size(), false);
+	auto in_list_threshold = bound[0].in_list_threshold;
+
+	vector<SemanticQueryGroup> groups;
+	unordered_map<string, idx_t> group_index;
+	vector<idx_t> single_queries;
+	for (idx_t i = 0; i < queries.size(); i++) {
+		if (!IsShareable(queries[i])) {
+			single_queries.push_back(i);
+			continue;
+		}
+		auto key = GetGroupKey(queries[i], in_list_threshold);
+		auto entry = group_index.find(key);
+		if (entry == group_index.end()) {
+			entry = group_index.emplace(key, groups.size()).first;
+			groups.emplace_back();
+		}
+		auto &group = groups[entry->second];
+		group.queries.push_back(i);
+		AddUnique(group.measures, bound[i].measures);
+		AddUnique(group.dimensions, bound[i].dimensions);
+	}
+
+	vector<unique_ptr<QueryNode>> parts;
+	for (auto &group : groups) {
+		if (group.queries.size() == 1 || group.dimensions.size() > MAX_GROUP_DIMENSIONS) {
+			single_queries.insert(single_queries.end(), group.queries.begin(), group.queries.end());
+			continue;
+		}
+		parts.push_back(CompileSharedScan(queries, bound, group));
+	}
+	std::sort(single_queries.begin(), single_queries.end());
+	for (auto query_idx : single_queries) {
+		bool plan_cache_hit = false;
+		parts.push_back(CompileSingleQuery(registry, queries[query_idx], bound[query_idx], query_idx, plan_cache_hit));
+		plan_cache_hits[query_idx] = plan_cache_hit;
+	}
+	auto batch = std::move(parts[0]);
+	for (idx_t i = 1; i < parts.size(); i++) {
+		auto union_node = make_uniq<SetOperationNode>();
+		union_node->setop_type = SetOperationType::UNION_BY_NAME;
+		union_node->setop_all = true;
+		union_node->left = std::move(batch);
+		union_node->right = std::move(parts[i]);
+		batch = std::move(union_node);
+	}
+	return batch;
+}
+
+static unique_ptr<QueryNode> CompileSemanticQueryBatch(ClientContext &context, const string &batch_json) {
+	vector<BoundSemanticQuery> bound;
+	auto queries = ParseAndValidateBatch(context, batch_json, bound);
+	vector<bool> plan_cache_hits;
+	return CompileValidatedBatch(DatasetRegistry::Get(context), queries, bound, plan_cache_hits);
+}
+
+static bool IsExplainMode(const TableFunctionBindInput &input) {
+	return input.inputs.size() > 1 && input.inputs[1].type() == LogicalType::BOOLEAN &&
+	       input.inputs[1].GetValue<bool>();
+}
+
+static bool IsParallelMode(const TableFunctionBindInput &input) {
+	auto entry = input.named_parameters.find("parallel");
+	return entry != input.named_parameters.end() && !entry->second.IsNull() && entry->second.GetValue<bool>();
+}
+
+// Like SEMANTIC_QUERY, the compiled statement is substituted for the table function
+static unique_ptr<TableRef> SemanticQueryBatchBindReplace(ClientContext &context, TableFunctionBindInput &input) {
+	if (IsExplainMode(input) || IsParallelMode(input)) {
+		return nullptr;
+	}
+	auto select_stmt = make_uniq<SelectStatement>();
+	select_stmt->node = CompileSemanticQueryBatch(context, input.inputs[0].GetValue<string>());
+	return make_uniq<SubqueryRef>(std::move(select_stmt));
+}
+
+//===--------------------------------------------------------------------===//
+// Parallel mode
+//===--------------------------------------------------------------------===//
+// semantic_query_batch(json, parallel := true) compiles and prepares every query of the batch when it is bound and
+// runs them side by side as tasks of the database's TaskScheduler, each on its own connection, instead of merging
+// them into one statement. The pipelines of all queries are then in the scheduler at the same time, so a small query
+// does not wait for a large one and idle threads pick up work of any query. Queries do not share scans in this mode.
+// Its rows are those of the union of the queries, with the time each query spent waiting for a thread (queue_ms)
+// and running (run_ms). As the queries run on connections of their own, they see committed data only.
+static constexpr idx_t PARALLEL_MEMBER_COLUMNS_START = 3;
+
+struct SemanticParallelQuery {
+	//! A connection per query, so that the prepared statements can run at the same time
+	unique_ptr<Connection> connection;
+	//! Prepared when the batch is bound, which also gives the query's result columns
+	unique_ptr<PreparedStatement> prepared;
+	//! Output column of each column of the query's result
+	vector<idx_t> output_columns;
+};
+
+struct SemanticParallelResult {
+	unique_ptr<ColumnDataCollection> collection;
+	//! Both in seconds, measured from when the batch was scheduled
+	double queue_time = 0;
+	double run_time = 0;
+};
+
+class SemanticParallelQueryTask : public BaseExecutorTask {
+public:
+	SemanticParallelQueryTask(TaskExecutor &executor, PreparedStatement &prepared, const Profiler &clock,
+	                          SemanticParallelResult &result)
+	    : BaseExecutorTask(executor), prepared(prepared), clock(clock), result(result) {
+	}
+
+	void ExecuteTask() override {
+		result.queue_time = clock.Elapsed();
+		vector<Value> parameters;
+		auto pending = prepared.PendingQuery(parameters, false);
+		if (pending->HasError()) {
+			pending->ThrowError();
+		}
+		// Works on the tasks of the query's pipelines, which the other threads of the scheduler pick up as well
+		PendingExecutionResult execution_result;
+		do {
+			execution_result = pending->ExecuteTask();
+			if (execution_result == PendingExecutionResult::BLOCKED) {
+				pending->WaitForTask();
+			}
+		} while (!PendingQueryResult::IsResultReady(execution_result) &&
+		         execution_result != PendingExecutionResult::EXECUTION_ERROR);
+		if (execution_result == PendingExecutionResult::EXECUTION_ERROR) {
+			pending->ThrowError();
+		}
+		auto query_result = pending->Execute();
+		if (query_result->HasError()) {
+			query_result->ThrowError();
+		}
+		result.collection = query_result->Cast<MaterializedQueryResult>().TakeCollection();
+		result.run_time = clock.Elapsed() - result.queue_time;
+	}
+
+private:
+	PreparedStatement &prepared;
+	const Profiler &clock;
+	SemanticParallelResult &result;
+};
+
+// Prepares every compiled query on a side connection of its own. Their result columns are united by name.
+static void BindParallelQueries(ClientContext &context, const string &batch_json,
+                                vector<SemanticParallelQuery> &parallel_queries, vector<LogicalType> &return_types,
+                                vector<string> &names) {
+	vector<BoundSemanticQuery> bound;
+	auto queries = ParseAndValidateBatch(context, batch_json, bound);
+	auto &registry = DatasetRegistry::Get(context);
+	names = {"query_index", "queue_ms", "run_ms"};
+	return_types = {LogicalType::INTEGER, LogicalType::DOUBLE, LogicalType::DOUBLE};
+	case_insensitive_map_t<idx_t> column_index;
+	for (idx_t i = 0; i < queries.size(); i++) {
+		bool plan_cache_hit = false;
+		auto select_stmt = make_uniq<SelectStatement>();
+		select_stmt->node = CompileCachedSemanticQuery(registry, queries[i], bound[i], plan_cache_hit);
+		SemanticParallelQuery parallel_query;
+		parallel_query.connection = MakeSemanticSideConnection(context);
+		parallel_query.prepared = parallel_query.connection->Prepare(std::move(select_stmt));
+		auto &prepared = *parallel_query.prepared;
+		if (prepared.HasError()) {
+			throw InvalidInputException("Semantic query %d of the batch failed to bind: %s", i, prepared.GetError());
+		}
+		auto &query_names = prepared.GetNames();
+		auto query_types = prepared.GetTypes();
+		for (idx_t col = 0; col < query_names.size(); col++) {
+			auto entry = column_index.find(query_names[col]);
+			if (entry == column_index.end()) {
+				entry = column_index.emplace(query_names[col], names.size()).first;
+				names.push_back(query_names[col]);
+				return_types.push_back(query_types[col]);
+			} else {
+				auto &type = return_types[entry->second];
+				type = LogicalType::ForceMaxLogicalType(type, query_types[col]);
+			}
+			parallel_query.output_columns.push_back(entry->second);
+		}
+		parallel_queries.push_back(std::move(parallel_query));
+	}
+}
+
+//===--------------------------------------------------------------------===//
+// Explain and parallel modes
+//===--------------------------------------------------------------------===//
+// Explain mode: semantic_query_batch(json, true) returns the compiled SQL
+struct SemanticQueryBatchData : public TableFunctionData {
+	string compiled_sql;
+	bool parallel = false;
+	vector<SemanticParallelQuery> parallel_queries;
+};
+
+struct SemanticQueryBatchState : public GlobalTableFunctionState {
+	bool finished = false;
+	vector<SemanticParallelResult> results;
+	//! The result being returned in parallel mode, and the position in it
+	idx_t query_idx = 0;
+	bool scan_started = false;
+	ColumnDataScanState scan_state;
+	DataChunk scan_chunk;
+};
+
+static unique_ptr<FunctionData> SemanticQueryBatchBind(ClientContext &context, TableFunctionBindInput &input,
+                                                       vector<LogicalType> &return_types, vector<string> &names) {
+	auto data = make_uniq<SemanticQueryBatchData>();
+	if (IsParallelMode(input) && !IsExplainMode(input)) {
+		data->parallel = true;
+		BindParallelQueries(context, input.inputs[0].GetValue<string>(), data->parallel_queries, return_types, names);
+		return std::move(data);
+	}
+	data->compiled_sql = CompileSemanticQueryBatch(context, input.inputs[0].GetValue<string>())->ToString();
+	return_types = {LogicalType::VARCHAR};
+	names = {"compiled_sql"};
+	return std::move(data);
+}
+
+// Parallel mode runs all queries here, before the first row is returned. The calling thread works on the tasks too.
+static unique_ptr<GlobalTableFunctionState> SemanticQueryBatchInit(ClientContext &context,
+                                                                   TableFunctionInitInput &input) {
+	auto result = make_uniq<SemanticQueryBatchState>();
+	auto &data = input.bind_data->Cast<SemanticQueryBatchData>();
+	if (!data.parallel) {
+		return std::move(result);
+	}
+	result->results.resize(data.parallel_queries.size());
+	TaskExecutor executor(context);
+	Profiler clock;
+	clock.Start();
+	for (idx_t i = 0; i < data.parallel_queries.size(); i++) {
+		executor.ScheduleTask(make_uniq<SemanticParallelQueryTask>(executor, *data.parallel_queries[i].prepared, clock,
+		                                                           result->results[i]));
+	}
+	executor.WorkOnTasks();
+	return std::move(result);
+}
+
+static Value Milliseconds(double seconds) {
+	return Value::DOUBLE(seconds * 1000.0);
+}
+
+// Returns the results a chunk at a time, cast column by column to the united types. The columns of the batch that a
+// query does not have are NULL in its rows.
+static void SemanticParallelBatchFunction(ClientContext &context, const SemanticQueryBatchData &data,
+                                          SemanticQueryBatchState &state, DataChunk &output) {
+	while (state.query_idx < state.results.size()) {
+		auto &query_result = state.results[state.query_idx];
+		auto &collection = *query_result.collection;
+		if (!state.scan_started) {
+			collection.InitializeScan(state.scan_state);
+			state.scan_chunk.Destroy();
+			state.scan_chunk.Initialize(context, collection.Types());
+			state.scan_started = true;
+		}
+		state.scan_chunk.Reset();
+		if (!collection.Scan(state.scan_state, state.scan_chunk)) {
+			state.query_idx++;
+			state.scan_started = false;
+			continue;
+		}
+		auto count = state.scan_chunk.size();
+		output.data[0].Reference(Value::INTEGER(NumericCast<int32_t>(state.query_idx)));
+		output.data[1].Reference(Milliseconds(query_result.queue_time));
+		output.data[2].Reference(Milliseconds(query_result.run_time));
+		vector<bool> has_column(output.ColumnCount(), false);
+		auto &output_columns = data.parallel_queries[state.query_idx].output_columns;
+		for (idx_t col = 0; col < output_columns.size(); col++) {
+			VectorOperations::Cast(context, state.scan_chunk.data[col], output.data[output_columns[col]], count);
+			has_column[output_columns[col]] = true;
+		}
+		for (idx_t col = PARALLEL_MEMBER_COLUMNS_START; col < output.ColumnCount(); col++) {
+			if (!has_column[col]) {
+				output.data[col].Reference(Value(output.data[col].GetType()));
+			}
+		}
+		output.SetCardinality(count);
+		return;
+	}
+	output.SetCardinality(0);
+}
+
+static void SemanticQueryBatchFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->Cast<SemanticQueryBatchData>();
+	auto &state = data_p.global_state->Cast<SemanticQueryBatchState>();
+	if (data.parallel) {
+		SemanticParallelBatchFunction(context, data, state, output);
+		return;
+	}
+	if (state.finished) {
+		output.SetCardinality(0);
+		return;
+	}
+	output.SetCardinality(1);
+	output.SetValue(0, 0, Value(data.compiled_sql));
+	state.finished = true;
+}
+
+//===--------------------------------------------------------------------===//
+// semantic_query_each
+//===--------------------------------------------------------------------===//
+// In-out variant of SEMANTIC_QUERY over a VARCHAR column of query JSONs, e.g.
+//   SELECT * FROM semantic_query_each((SELECT definition FROM saved_reports))
+//   SELECT * FROM saved_reports, LATERAL semantic_query_each(saved_reports.definition)
+// Each result row of a query is returned as a JSON object of its members, next to the query and the row's position.
+// The distinct queries of an input chunk are compiled together as one batch, so they share scans, and run on a side
+// connection (committed data only). A query is evaluated by one thread at a time: threads whose input has a query
+// that another thread is evaluating wait for its result. Results are dropped once they have been returned for every
+// input row that asked for them, so a query that appears again in a later chunk runs again - from its cached plan.
+// LATERAL calls receive one row at a time, so for them this only dedupes concurrent calls.
+struct SemanticQueryEachResult {
+	//! Set, under the lock of the global state, once the query was evaluated
+	bool ready = false;
+	//! Set if the evaluation failed
+	ErrorData error;
+	//! The JSON object of each result row
+	vector<string> rows;
+};
+
+struct SemanticQueryEachGlobalState : public GlobalTableFunctionState {
+	mutex lock;
+	//! Notified whenever queries are evaluated
+	std::condition_variable evaluated;
+	//! The queries that are being evaluated or returned, by query JSON
+	unordered_map<string, weak_ptr<SemanticQueryEachResult>> results;
+};
+
+struct SemanticQueryEachLocalState : public LocalTableFunctionState {
+	unique_ptr<Connection> connection;
+	//! The queries of the current input chunk and their results - null for NULL queries
+	vector<string> queries;
+	vector<shared_ptr<SemanticQueryEachResult>> results;
+	bool evaluated = false;
+	//! Position of the next row to return
+	idx_t input_row = 0;
+	idx_t result_row = 0;
+};
+
+static void AppendJSONString(string &json, const char *data, idx_t size) {
+	json += '"';
+	for (idx_t i = 0; i < size; i++) {
+		auto c = data[i];
+		switch (c) {
+		case '"':
+			json += "\\\"";
+			break;
+		case '\\':
+			json += "\\\\";
+			break;
+		case '\n':
+			json += "\\n";
+			break;
+		case '\r':
+			json += "\\r";
+			break;
+		case '\t':
+			json += "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				char escaped[7];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+				json += escaped;
+			} else {
+				json += c;
+			}
+		}
+	}
+	json += '"';
+}
+
+// How the VARCHAR cast of a result column is written into the JSON objects
+enum class SemanticJSONKind : uint8_t { NUMBER, FLOATING, STRING };
+
+static SemanticJSONKind GetJSONKind(const LogicalType &type) {
+	if (type.id() == LogicalTypeId::FLOAT || type.id() == LogicalTypeId::DOUBLE) {
+		return SemanticJSONKind::FLOATING;
+	}
+	if (type.id() == LogicalTypeId::BOOLEAN || type.IsNumeric()) {
+		return SemanticJSONKind::NUMBER;
+	}
+	return SemanticJSONKind::STRING;
+}
+
+static void AppendJSONValue(string &json, const string_t &value, SemanticJSONKind kind) {
+	if (kind == SemanticJSONKind::STRING) {
+		AppendJSONString(json, value.GetData(), value.GetSize());
+		return;
+	}
+	// JSON has no infinities or NaN
+	if (kind == SemanticJSONKind::FLOATING && (value == string_t("inf") || value == string_t("-inf") ||
+	                                           value == string_t("nan"))) {
+		json += "null";
+		return;
+	}
+	json.append(value.GetData(), value.GetSize());
+}
+
+// Parses, validates and compiles the queries as one batch, recording each of them in semantic_query_stats() - the
+// time it takes to compile the batch is split evenly among its queries
+static unique_ptr<QueryNode> CompileQueries(DatasetRegistry &registry, const vector<string> &query_jsons,
+                                            vector<SemanticQuery> &queries) {
+	auto &query_stats = registry.GetQueryStats();
+	auto in_list_threshold = registry.GetInListThreshold();
+	queries.resize(query_jsons.size());
+	vector<BoundSemanticQuery> bound(query_jsons.size());
+	vector<SemanticQueryTimings> timings(query_jsons.size());
+	for (idx_t i = 0; i < query_jsons.size(); i++) {
+		try {
+			{
+				SemanticPhaseTimer timer(timings[i], SemanticQueryPhase::PARSE);
+				queries[i] = ParseSemanticQuery(query_jsons[i]);
+			}
+			SemanticPhaseTimer timer(timings[i], SemanticQueryPhase::VALIDATE);
+			string error_msg;
+			if (!registry.ValidateQuery(queries[i], bound[i], error_msg)) {
+				throw InvalidInputException("Semantic query validation failed: %s", error_msg);
+			}
+			bound[i].in_list_threshold = in_list_threshold;
+		} catch (...) {
+			timings[i].total = timings[i].phases[static_cast<idx_t>(SemanticQueryPhase::PARSE)] +
+			                   timings[i].phases[static_cast<idx_t>(SemanticQueryPhase::VALIDATE)];
+			query_stats.Record(queries[i].dataset, timings[i], false, true);
+			throw;
+		}
+	}
+	vector<bool> plan_cache_hits(queries.size(), false);
+	SemanticQueryTimings batch_timings;
+	unique_ptr<QueryNode> batch;
+	std::exception_ptr error;
+	try {
+		SemanticPhaseTimer timer(batch_timings, SemanticQueryPhase::COMPILE);
+		batch = CompileValidatedBatch(registry, queries, bound, plan_cache_hits);
+	} catch (...) {
+		error = std::current_exception();
+	}
+	auto compile_time = batch_timings.phases[static_cast<idx_t>(SemanticQueryPhase::COMPILE)] / queries.size();
+	for (idx_t i = 0; i < queries.size(); i++) {
+		timings[i].phases[static_cast<idx_t>(SemanticQueryPhase::COMPILE)] += compile_time;
+		for (auto phase_time : timings[i].phases) {
+			timings[i].total += phase_time;
+		}
+		query_stats.Record(queries[i].dataset, timings[i], plan_cache_hits[i], error != nullptr);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return batch;
+}
+
+// Runs the queries as one batch and writes a JSON object per row of each query, holding the query's members in
+// result order. The result is converted a chunk at a time, through a VARCHAR cast of each of its column vectors.
+static vector<vector<string>> EvaluateQueries(ClientContext &context, Connection &con,
+                                              const vector<string> &query_jsons) {
+	vector<SemanticQuery> queries;
+	auto select_stmt = make_uniq<SelectStatement>();
+	select_stmt->node = CompileQueries(DatasetRegistry::Get(context), query_jsons, queries);
+	auto result = con.Query(std::move(select_stmt));
+	if (result->HasError()) {
+		result->ThrowError();
+	}
+	case_insensitive_map_t<idx_t> column_index;
+	vector<SemanticJSONKind> column_kinds;
+	for (idx_t col = 0; col < result->names.size(); col++) {
+		column_index[result->names[col]] = col;
+		column_kinds.push_back(GetJSONKind(result->types[col]));
+	}
+	// The members of each query, and the JSON text before each of their values ({"name": and ,"name":)
+	vector<vector<idx_t>> member_columns(queries.size());
+	vector<vector<string>> member_prefixes(queries.size());
+	for (idx_t i = 0; i < queries.size(); i++) {
+		vector<string> names;
+		names.insert(names.end(), queries[i].measures.begin(), queries[i].measures.end());
+		names.insert(names.end(), queries[i].dimensions.begin(), queries[i].dimensions.end());
+		for (auto &time_dim : queries[i].time_dimensions) {
+			names.push_back(time_dim.dimension);
+		}
+		for (auto &name : names) {
+			member_columns[i].push_back(column_index.at(name));
+			string prefix(member_prefixes[i].empty() ? "{" : ",");
+			AppendJSONString(prefix, name.c_str(), name.size());
+			prefix += ':';
+			member_prefixes[i].push_back(std::move(prefix));
+		}
+	}
+	auto query_index_column = column_index.at("query_index");
+
+	vector<vector<string>> rows(queries.size());
+	auto &collection = result->Collection();
+	DataChunk strings;
+	strings.Initialize(context, vector<LogicalType>(collection.ColumnCount(), LogicalType::VARCHAR));
+	vector<UnifiedVectorFormat> formats(collection.ColumnCount());
+	for (auto &chunk : collection.Chunks()) {
+		strings.Reset();
+		for (idx_t col = 0; col < chunk.ColumnCount(); col++) {
+			if (col == query_index_column) {
+				chunk.data[col].ToUnifiedFormat(chunk.size(), formats[col]);
+				continue;
+			}
+			VectorOperations::Cast(context, chunk.data[col], strings.data[col], chunk.size());
+			strings.data[col].ToUnifiedFormat(chunk.size(), formats[col]);
+		}
+		auto query_indexes = UnifiedVectorFormat::GetData<int32_t>(formats[query_index_column]);
+		for (idx_t row = 0; row < chunk.size(); row++) {
+			auto query_idx = NumericCast<idx_t>(query_indexes[formats[query_index_column].sel->get_index(row)]);
+			auto &columns = member_columns[query_idx];
+			string object;
+			for (idx_t i = 0; i < columns.size(); i++) {
+				auto &format = formats[columns[i]];
+				auto idx = format.sel->get_index(row);
+				object += member_prefixes[query_idx][i];
+				if (!format.validity.RowIsValid(idx)) {
+					object += "null";
+				} else {
+					AppendJSONValue(object, UnifiedVectorFormat::GetData<string_t>(format)[idx],
+					                column_kinds[columns[i]]);
+				}
+			}
+			object += columns.empty() ? "{}" : "}";
+			rows[query_idx].push_back(std::move(object));
+		}
+	}
+	return rows;
+}
+
+static void EvaluateChunk(ClientContext &context, SemanticQueryEachGlobalState &global_state,
+                          SemanticQueryEachLocalState &state, DataChunk &input) {
+	UnifiedVectorFormat input_format;
+	input.data[0].ToUnifiedFormat(input.size(), input_format);
+	auto input_queries = UnifiedVectorFormat::GetData<string_t>(input_format);
+	state.queries.assign(input.size(), string());
+	state.results.assign(input.size(), nullptr);
+	// The queries no other thread is evaluating or returning are evaluated by this one
+	vector<string> missing;
+	vector<shared_ptr<SemanticQueryEachResult>> missing_results;
+	{
+		lock_guard<mutex> guard(global_state.lock);
+		for (idx_t row = 0; row < input.size(); row++) {
+			auto idx = input_format.sel->get_index(row);
+			if (!input_format.validity.RowIsValid(idx)) {
+				continue;
+			}
+			state.queries[row] = input_queries[idx].GetString();
+			auto &entry = global_state.results[state.queries[row]];
+			auto result = entry.lock();
+			if (!result) {
+				result = make_shared_ptr<SemanticQueryEachResult>();
+				entry = result;
+				missing.push_back(state.queries[row]);
+				missing_results.push_back(result);
+			}
+			state.results[row] = std::move(result);
+		}
+	}
+	if (!missing.empty()) {
+		ErrorData error;
+		vector<vector<string>> rows;
+		try {
+			if (!state.connection) {
+				state.connection = MakeSemanticSideConnection(context);
+			}
+			rows = EvaluateQueries(context, *state.connection, missing);
+		} catch (std::exception &ex) {
+			error = ErrorData(ex);
+		}
+		{
+			lock_guard<mutex> guard(global_state.lock);
+			for (idx_t i = 0; i < missing_results.size(); i++) {
+				if (error.HasError()) {
+					missing_results[i]->error = error;
+				} else {
+					missing_results[i]->rows = std::move(rows[i]);
+				}
+				missing_results[i]->ready = true;
+			}
+		}
+		global_state.evaluated.notify_all();
+		if (error.HasError()) {
+			error.Throw();
+		}
+	}
+	std::unique_lock<mutex> guard(global_state.lock);
+	for (auto &result : state.results) {
+		if (!result) {
+			continue;
+		}
+		global_state.evaluated.wait(guard, [&]() { return result->ready; });
+		if (result->error.HasError()) {
+			auto error = result->error;
+			guard.unlock();
+			error.Throw();
+		}
+	}
+}
+
+// Drops the results of the chunk that no other thread is returning
+static void ReleaseChunk(SemanticQueryEachGlobalState &global_state, SemanticQueryEachLocalState &state) {
+	lock_guard<mutex> guard(global_state.lock);
+	state.results.clear();
+	for (auto &query : state.queries) {
+		auto entry = global_state.results.find(query);
+		if (entry != global_state.results.end() && entry->second.expired()) {
+			global_state.results.erase(entry);
+		}
+	}
+	state.queries.clear();
+}
+
+static unique_ptr<FunctionData> SemanticQueryEachBind(ClientContext &context, TableFunctionBindInput &input,
+                                                      vector<LogicalType> &return_types, vector<string> &names) {
+	// A subquery argument is the input table itself
+	if (!input.input_table_types.empty() &&
+	    (input.input_table_types.size() != 1 || input.input_table_types[0].id() != LogicalTypeId::VARCHAR)) {
+		throw InvalidInputException("semantic_query_each requires a single VARCHAR column of semantic queries");
+	}
+	names = {"query", "row_index", "result"};
+	return_types = {LogicalType::VARCHAR, LogicalType::BIGINT, LogicalType::VARCHAR};
+	return make_uniq<TableFunctionData>();
+}
+
+static unique_ptr<GlobalTableFunctionState> SemanticQueryEachInit(ClientContext &context,
+                                                                  TableFunctionInitInput &input) {
+	return make_uniq<SemanticQueryEachGlobalState>();
+}
+
+static unique_ptr<LocalTableFunctionState> SemanticQueryEachInitLocal(ExecutionContext &context,
+                                                                      TableFunctionInitInput &input,
+                                                                      GlobalTableFunctionState *global_state) {
+	return make_uniq<SemanticQueryEachLocalState>();
+}
+
+static OperatorResultType SemanticQueryEachFunction(ExecutionContext &context, TableFunctionInput &data_p,
+                                                    DataChunk &input, DataChunk &output) {
+	auto &global_state = data_p.global_state->Cast<SemanticQueryEachGlobalState>();
+	auto &state = data_p.local_state->Cast<SemanticQueryEachLocalState>();
+	if (!state.evaluated) {
+		EvaluateChunk(context.client, global_state, state, input);
+		state.evaluated = true;
+		state.input_row = 0;
+		state.result_row = 0;
+	}
+	auto query_data = FlatVector::GetData<string_t>(output.data[0]);
+	auto row_index_data = FlatVector::GetData<int64_t>(output.data[1]);
+	auto result_data = FlatVector::GetData<string_t>(output.data[2]);
+	idx_t count = 0;
+	while (state.input_row < input.size()) {
+		auto &result = state.results[state.input_row];
+		if (!result || state.result_row >= result->rows.size()) {
+			state.input_row++;
+			state.result_row = 0;
+			continue;
+		}
+		if (count == STANDARD_VECTOR_SIZE) {
+			output.SetCardinality(count);
+			return OperatorResultType::HAVE_MORE_OUTPUT;
+		}
+		query_data[count] = StringVector::AddString(output.data[0], state.queries[state.input_row]);
+		row_index_data[count] = NumericCast<int64_t>(state.result_row);
+		result_data[count] = StringVector::AddString(output.data[2], result->rows[state.result_row]);
+		state.result_row++;
+		count++;
+	}
+	output.SetCardinality(count);
+	ReleaseChunk(global_state, state);
+	state.evaluated = false;
+	return OperatorResultType::NEED_MORE_INPUT;
+}
+
+void RegisterSemanticQueryBatchFunctions(DatabaseInstance &instance) {
+	TableFunction batch_func("semantic_query_batch", {LogicalType::VARCHAR}, SemanticQueryBatchFunction,
+	                         SemanticQueryBatchBind, SemanticQueryBatchInit);
+	batch_func.bind_replace = SemanticQueryBatchBindReplace;
+	batch_func.varargs = LogicalType::ANY;
+	batch_func.named_parameters["parallel"] = LogicalType::BOOLEAN;
+	ExtensionUtil::RegisterFunction(instance, batch_func);
+
+	TableFunctionSet each_set("semantic_query_each");
+	for (auto &argument_type : {LogicalType::VARCHAR, LogicalType::TABLE}) {
+		TableFunction each_func({argument_type}, nullptr, SemanticQueryEachBind, SemanticQueryEachInit,
+		                        SemanticQueryEachInitLocal);
+		each_func.in_out_function = SemanticQueryEachFunction;
+		each_set.AddFunction(each_func);
+	}
+	ExtensionUtil::RegisterFunction(instance, each_set);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
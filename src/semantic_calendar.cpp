@@ -0,0 +1,62 @@
+#include "quack_extension.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/extension_util.hpp"
+#include "duckdb/parser/expression/columnref_expression.hpp"
+#include "duckdb/parser/parser.hpp"
+#include "duckdb/parser/statement/select_statement.hpp"
+#include "duckdb/parser/tableref/subqueryref.hpp"
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+// The periods of the calendar table, in the columns that the time granularities of the same name look up
+static const char *const CALENDAR_GRANULARITIES[] = {"week", "month",          "quarter",
+                                                     "year", "fiscal_quarter", "fiscal_year"};
+
+// semantic_calendar(start, end, fiscal_year_start_month := 1) has one row per day from start to end - materialize it
+// with CREATE TABLE ... AS and name it as the "calendar_table" of datasets with the same fiscal_year_start_month.
+// Like SEMANTIC_QUERY, the function is replaced by the SQL it compiles to.
+static unique_ptr<TableRef> SemanticCalendarBindReplace(ClientContext &context, TableFunctionBindInput &input) {
+	if (input.inputs[0].IsNull() || input.inputs[1].IsNull()) {
+		throw InvalidInputException("semantic_calendar requires a start and an end date");
+	}
+	int64_t fiscal_year_start_month = 1;
+	auto entry = input.named_parameters.find("fiscal_year_start_month");
+	if (entry != input.named_parameters.end() && !entry->second.IsNull()) {
+		fiscal_year_start_month = entry->second.GetValue<int64_t>();
+	}
+	if (fiscal_year_start_month < 1 || fiscal_year_start_month > 12) {
+		throw InvalidInputException("fiscal_year_start_month must be between 1 and 12");
+	}
+
+	vector<string> columns {"CAST(__calendar.d AS DATE) AS calendar_date"};
+	for (auto granularity : CALENDAR_GRANULARITIES) {
+		auto period = CompileTimeTruncation(granularity, make_uniq<ColumnRefExpression>("d", "__calendar"),
+		                                    NumericCast<idx_t>(fiscal_year_start_month));
+		columns.push_back(StringUtil::Format("CAST(%s AS DATE) AS %s", period->ToString(), granularity));
+	}
+	auto sql = StringUtil::Format("SELECT %s FROM range(CAST(%s AS TIMESTAMP), CAST(%s AS TIMESTAMP) + INTERVAL 1 DAY, "
+	                              "INTERVAL 1 DAY) AS __calendar(d)",
+	                              StringUtil::Join(columns, ", "), input.inputs[0].ToSQLString(),
+	                              input.inputs[1].ToSQLString());
+	Parser parser;
+	parser.ParseQuery(sql);
+	D_ASSERT(parser.statements.size() == 1);
+	auto select_stmt = unique_ptr_cast<SQLStatement, SelectStatement>(std::move(parser.statements[0]));
+	return make_uniq<SubqueryRef>(std::move(select_stmt));
+}
+
+void RegisterSemanticCalendarFunctions(DatabaseInstance &instance) {
+	TableFunction calendar_func("semantic_calendar", {LogicalType::DATE, LogicalType::DATE}, nullptr, nullptr);
+	calendar_func.bind_replace = SemanticCalendarBindReplace;
+	calendar_func.named_parameters["fiscal_year_start_month"] = LogicalType::BIGINT;
+	ExtensionUtil::RegisterFunction(instance, calendar_func);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
@@ -0,0 +1,846 @@
+#include "quack_extension.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/date.hpp"
+#include "duckdb/common/unordered_set.hpp"
+#include "duckdb/parser/parsed_expression_iterator.hpp"
+#include "duckdb/parser/parser.hpp"
+#include "duckdb/parser/qualified_name.hpp"
+#include "duckdb/parser/expression/between_expression.hpp"
+#include "duckdb/parser/expression/cast_expression.hpp"
+#include "duckdb/parser/expression/columnref_expression.hpp"
+#include "duckdb/parser/expression/comparison_expression.hpp"
+#include "duckdb/parser/expression/conjunction_expression.hpp"
+#include "duckdb/parser/expression/constant_expression.hpp"
+#include "duckdb/parser/expression/function_expression.hpp"
+#include "duckdb/parser/expression/operator_expression.hpp"
+#include "duckdb/parser/expression/subquery_expression.hpp"
+#include "duckdb/parser/query_node/select_node.hpp"
+#include "duckdb/parser/result_modifier.hpp"
+#include "duckdb/parser/statement/select_statement.hpp"
+#include "duckdb/parser/tableref/basetableref.hpp"
+#include "duckdb/parser/tableref/emptytableref.hpp"
+#include "duckdb/parser/tableref/joinref.hpp"
+#include "duckdb/parser/tableref/subqueryref.hpp"
+
+#include <algorithm>
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+unique_ptr<ParsedExpression> ParseSemanticExpression(const string &sql) {
+	auto expressions = Parser::ParseExpressionList(sql);
+	if (expressions.size() != 1) {
+		throw InvalidInputException("Expected a single SQL expression but got \"%s\"", sql);
+	}
+	return std::move(expressions[0]);
+}
+
+// Aggregates that make a measure's sql a complete aggregate expression, as in "SUM(amount) / COUNT(*)"
+static bool IsAggregateFunction(const FunctionExpression &function) {
+	static const unordered_set<string> AGGREGATE_FUNCTIONS {
+	    "any_value", "approx_count_distinct", "approx_quantile", "arg_max", "arg_min", "avg", "bool_and", "bool_or",
+	    "count", "count_star", "first", "fsum", "histogram", "last", "list", "max", "mean", "median", "min", "mode",
+	    "product", "quantile", "quantile_cont", "quantile_disc", "stddev", "stddev_pop", "stddev_samp", "string_agg",
+	    "sum", "var_pop", "var_samp", "variance"};
+	return function.distinct || function.filter || (function.order_bys && !function.order_bys->orders.empty()) ||
+	       AGGREGATE_FUNCTIONS.count(StringUtil::Lower(function.function_name)) > 0;
+}
+
+static bool ContainsAggregate(const ParsedExpression &expr) {
+	if (expr.GetExpressionClass() == ExpressionClass::WINDOW) {
+		return true;
+	}
+	if (expr.GetExpressionClass() == ExpressionClass::FUNCTION &&
+	    IsAggregateFunction(expr.Cast<FunctionExpression>())) {
+		return true;
+	}
+	bool result = false;
+	ParsedExpressionIterator::EnumerateChildren(
+	    expr, [&](const ParsedExpression &child) { result = result || ContainsAggregate(child); });
+	return result;
+}
+
+// The sql of a measure is either a complete aggregate expression, kept as is, or the expression that the aggregate
+// of the measure's type is computed over: {"type": "count_distinct", "sql": "user_id"} is COUNT(DISTINCT user_id).
+// A "*" is counted with count_star().
+unique_ptr<ParsedExpression> CompileMeasureExpression(const SemanticMeasure &measure) {
+	auto expr = ParseSemanticExpression(measure.sql_expression);
+	if (ContainsAggregate(*expr)) {
+		return expr;
+	}
+	auto type = StringUtil::Lower(measure.aggregation_type);
+	vector<unique_ptr<ParsedExpression>> children;
+	if (expr->GetExpressionClass() == ExpressionClass::STAR) {
+		if (type != "count") {
+			throw InvalidInputException("Measure '%s' of type '%s' cannot aggregate \"*\"", measure.name,
+			                            measure.aggregation_type);
+		}
+		return make_uniq<FunctionExpression>("count_star", std::move(children));
+	}
+	children.push_back(std::move(expr));
+	if (type == "sum" || type == "count" || type == "avg" || type == "min" || type == "max" ||
+	    type == "approx_count_distinct") {
+		return make_uniq<FunctionExpression>(type, std::move(children));
+	}
+	if (type == "count_distinct") {
+		return make_uniq<FunctionExpression>("count", std::move(children), nullptr, nullptr, true);
+	}
+	if (type == "approx_percentile") {
+		children.push_back(make_uniq<ConstantExpression>(Value::DOUBLE(measure.percentile)));
+		return make_uniq<FunctionExpression>("approx_quantile", std::move(children));
+	}
+	throw InvalidInputException("Measure '%s' has unsupported type '%s' - expected sum, count, count_distinct, avg, "
+	                            "min, max, approx_count_distinct or approx_percentile",
+	                            measure.name, measure.aggregation_type);
+}
+
+// The type only says how the measure combines when its aggregate was generated from its sql. A complete aggregate
+// expression is kept as is, and only combines when it is that same aggregate written out: SUM(a) typed sum does,
+// SUM(a) / COUNT(*) typed sum or COUNT(DISTINCT a) typed count do not.
+bool IsCombinableMeasure(const SemanticMeasure &measure) {
+	auto type = StringUtil::Lower(measure.aggregation_type);
+	if (type != "sum" && type != "count" && type != "min" && type != "max") {
+		return false;
+	}
+	auto sql = ParseSemanticExpression(measure.sql_expression);
+	if (!measure.expression->Equals(*sql)) {
+		return true;
+	}
+	if (sql->GetExpressionClass() != ExpressionClass::FUNCTION) {
+		return false;
+	}
+	auto &function = sql->Cast<FunctionExpression>();
+	if (function.children.size() > 1) {
+		return false;
+	}
+	SemanticMeasure argument_measure;
+	argument_measure.name = measure.name;
+	argument_measure.aggregation_type = type;
+	// count_star() has no argument
+	argument_measure.sql_expression = function.children.empty() ? "*" : function.children[0]->ToString();
+	return CompileMeasureExpression(argument_measure)->Equals(*sql);
+}
+
+// Column reference for a (possibly qualified) member name
+static unique_ptr<ParsedExpression> MemberReference(const string &name) {
+	auto column_names = StringUtil::Split(name, '.');
+	if (column_names.empty()) {
+		throw InvalidInputException("Semantic query references an empty member name");
+	}
+	return make_uniq<ColumnRefExpression>(std::move(column_names));
+}
+
+bool IsSupportedGranularity(const string &granularity) {
+	static const unordered_set<string> GRANULARITIES {"hour",    "day",  "week",           "month",
+	                                                  "quarter", "year", "fiscal_quarter", "fiscal_year"};
+	return GRANULARITIES.find(granularity) != GRANULARITIES.end();
+}
+
+bool GranularityRollsUp(const string &from, const string &to) {
+	if (from == to) {
+		return true;
+	}
+	if (from == "hour") {
+		return IsSupportedGranularity(to);
+	}
+	if (from == "day") {
+		return to != "hour" && IsSupportedGranularity(to);
+	}
+	if (from == "month") {
+		return to == "quarter" || to == "year" || to == "fiscal_quarter" || to == "fiscal_year";
+	}
+	// Weeks straddle months and years
+	return from == "quarter" && to == "year";
+}
+
+static unique_ptr<ParsedExpression> ShiftByMonths(unique_ptr<ParsedExpression> expr, const char *op, idx_t months) {
+	vector<unique_ptr<ParsedExpression>> children;
+	children.push_back(std::move(expr));
+	children.push_back(make_uniq<ConstantExpression>(Value::INTERVAL(NumericCast<int32_t>(months), 0, 0)));
+	return make_uniq<FunctionExpression>(op, std::move(children), nullptr, nullptr, false, true);
+}
+
+// Fiscal periods are the calendar periods of the expression shifted back by the months the fiscal year starts
+// late, shifted forward again - so they are labeled with their first day, as DATEs
+unique_ptr<ParsedExpression> CompileTimeTruncation(const string &granularity, unique_ptr<ParsedExpression> expr,
+                                                   idx_t fiscal_year_start_month) {
+	D_ASSERT(IsSupportedGranularity(granularity));
+	bool fiscal = StringUtil::StartsWith(granularity, "fiscal_");
+	auto fiscal_offset = fiscal_year_start_month - 1;
+	if (fiscal && fiscal_offset > 0) {
+		expr = ShiftByMonths(std::move(expr), "-", fiscal_offset);
+	}
+	vector<unique_ptr<ParsedExpression>> children;
+	children.push_back(make_uniq<ConstantExpression>(Value(fiscal ? granularity.substr(7) : granularity)));
+	children.push_back(std::move(expr));
+	expr = make_uniq<FunctionExpression>("date_trunc", std::move(children));
+	if (!fiscal) {
+		return expr;
+	}
+	if (fiscal_offset > 0) {
+		expr = ShiftByMonths(std::move(expr), "+", fiscal_offset);
+	}
+	return make_uniq<CastExpression>(LogicalType::DATE, std::move(expr));
+}
+
+// The query's time zone applies to instants: TIMESTAMPTZ values are converted to the wall-clock time of the zone
+// before they are truncated. DATE and TIMESTAMP values are wall-clock times already.
+static bool UsesTimeZone(const SemanticDimension &dimension, const string &time_zone) {
+	return !time_zone.empty() && dimension.data_type.id() == LogicalTypeId::TIMESTAMP_TZ;
+}
+
+static unique_ptr<ParsedExpression> LocalTimeExpression(const SemanticDimension &dimension, const string &time_zone) {
+	auto time_expr = dimension.expression->Copy();
+	if (!UsesTimeZone(dimension, time_zone)) {
+		return time_expr;
+	}
+	vector<unique_ptr<ParsedExpression>> children;
+	children.push_back(make_uniq<ConstantExpression>(Value(time_zone)));
+	children.push_back(std::move(time_expr));
+	return make_uniq<FunctionExpression>("timezone", std::move(children));
+}
+
+static unique_ptr<BaseTableRef> QualifiedTableRef(const string &name) {
+	auto table_name = QualifiedName::Parse(name);
+	auto table_ref = make_uniq<BaseTableRef>();
+	table_ref->catalog_name = table_name.catalog;
+	table_ref->schema_name = table_name.schema;
+	table_ref->table_name = table_name.name;
+	return table_ref;
+}
+
+// Fiscal periods are looked up in the dataset's calendar table, when it has one: the source is LEFT JOINed with the
+// calendar on the day of the time dimension. The calendar's columns are renamed in a subquery, so that they never
+// clash with the columns the member expressions refer to.
+static unique_ptr<ParsedExpression> JoinCalendar(const SemanticDataset &dataset,
+                                                 unique_ptr<ParsedExpression> local_time, const string &granularity,
+                                                 idx_t time_dim_idx, unique_ptr<TableRef> &from_table) {
+	auto date_column = "__calendar_date_" + to_string(time_dim_idx);
+	auto period_column = "__calendar_period_" + to_string(time_dim_idx);
+	auto calendar = make_uniq<SelectNode>();
+	calendar->select_list.push_back(make_uniq<ColumnRefExpression>("calendar_date"));
+	calendar->select_list.back()->SetAlias(date_column);
+	calendar->select_list.push_back(make_uniq<ColumnRefExpression>(granularity));
+	calendar->select_list.back()->SetAlias(period_column);
+	calendar->from_table = QualifiedTableRef(dataset.calendar_table);
+	auto calendar_select = make_uniq<SelectStatement>();
+	calendar_select->node = std::move(calendar);
+
+	auto join = make_uniq<JoinRef>(JoinRefType::REGULAR);
+	join->type = JoinType::LEFT;
+	join->left = std::move(from_table);
+	join->right = make_uniq<SubqueryRef>(std::move(calendar_select), "__calendar_" + to_string(time_dim_idx));
+	auto day = make_uniq<CastExpression>(LogicalType::DATE, std::move(local_time));
+	join->condition = make_uniq<ComparisonExpression>(ExpressionType::COMPARE_EQUAL,
+	                                                  make_uniq<ColumnRefExpression>(date_column), std::move(day));
+	from_table = std::move(join);
+	return make_uniq<ColumnRefExpression>(period_column);
+}
+
+// The grouped time expression of the time_dim_idx-th time dimension of the query. Calendar lookups add their join
+// to from_table.
+static unique_ptr<ParsedExpression> CompileTimeExpression(const SemanticDataset &dataset,
+                                                          const SemanticDimension &dimension,
+                                                          const SemanticQuery &query, idx_t time_dim_idx,
+                                                          const SemanticRollup *rollup,
+                                                          unique_ptr<TableRef> &from_table) {
+	auto &time_dim = query.time_dimensions[time_dim_idx];
+	if (rollup) {
+		// The rollup column is already truncated to the rollup granularity
+		auto time_expr = make_uniq_base<ParsedExpression, ColumnRefExpression>(dimension.name);
+		if (time_dim.granularity == rollup->granularity) {
+			return time_expr;
+		}
+		return CompileTimeTruncation(time_dim.granularity, std::move(time_expr), dataset.fiscal_year_start_month);
+	}
+	auto time_expr = LocalTimeExpression(dimension, query.time_zone);
+	if (time_dim.granularity.empty()) {
+		return time_expr;
+	}
+	if (!dataset.calendar_table.empty() && StringUtil::StartsWith(time_dim.granularity, "fiscal_")) {
+		return JoinCalendar(dataset, std::move(time_expr), time_dim.granularity, time_dim_idx, from_table);
+	}
+	return CompileTimeTruncation(time_dim.granularity, std::move(time_expr), dataset.fiscal_year_start_month);
+}
+
+// Measure read from a rollup column - aggregated again if the rollup groups by more than the query
+static unique_ptr<ParsedExpression> CompileRollupMeasure(const SemanticMeasure &measure, bool reaggregate) {
+	auto column = make_uniq_base<ParsedExpression, ColumnRefExpression>(measure.name);
+	if (!reaggregate) {
+		return column;
+	}
+	auto aggregation_type = StringUtil::Lower(measure.aggregation_type);
+	vector<unique_ptr<ParsedExpression>> children;
+	children.push_back(std::move(column));
+	if (aggregation_type != "count") {
+		return make_uniq<FunctionExpression>(aggregation_type, std::move(children));
+	}
+	// Partial counts add up - cast back to BIGINT, the type of the count from the base table or an exact rollup, as
+	// sum() of a BIGINT is a HUGEINT
+	auto partial_sum = make_uniq<FunctionExpression>("sum", std::move(children));
+	return make_uniq<CastExpression>(LogicalType::BIGINT, std::move(partial_sum));
+}
+
+// Filter values are constants of the dimension's type, so that the comparison is against the raw column and not
+// against a cast of it - only then can the scan prune row groups with their min/max statistics
+static unique_ptr<ParsedExpression> TypedConstant(const string &value, const LogicalType &type, const string &member) {
+	Value constant(value);
+	if (type.id() == LogicalTypeId::VARCHAR || type.id() == LogicalTypeId::INVALID) {
+		return make_uniq<ConstantExpression>(std::move(constant));
+	}
+	Value typed_constant;
+	string error_message;
+	if (!constant.DefaultTryCastAs(type, typed_constant, &error_message)) {
+		throw InvalidInputException("Value '%s' for '%s' is not a valid %s", value, member, type.ToString());
+	}
+	return make_uniq<ConstantExpression>(std::move(typed_constant));
+}
+
+// The expression a filter or date range compares: the dimension's sql (or the rollup column named after it), or the
+// column itself for a filter on a name that is not a dimension
+static unique_ptr<ParsedExpression> FilterOperand(const SemanticDimension *dimension, const string &member,
+                                                  const SemanticRollup *rollup) {
+	if (!dimension) {
+		return MemberReference(member);
+	}
+	if (rollup) {
+		return make_uniq<ColumnRefExpression>(dimension->name);
+	}
+	return dimension->expression->Copy();
+}
+
+// Midnight of a day in the time zone, as an instant - constant-folded before the filter is pushed into the scan
+static unique_ptr<ParsedExpression> ZonedMidnight(unique_ptr<ParsedExpression> day, const string &time_zone) {
+	vector<unique_ptr<ParsedExpression>> children;
+	children.push_back(make_uniq<ConstantExpression>(Value(time_zone)));
+	children.push_back(make_uniq<CastExpression>(LogicalType::TIMESTAMP, std::move(day)));
+	return make_uniq<FunctionExpression>("timezone", std::move(children));
+}
+
+// A date range covers whole days: [start, end + 1 day) on the raw time expression, with DATE constants. The
+// half-open range keeps the last day for timestamp columns and compares the column without truncating it. Days
+// of TIMESTAMPTZ columns start at midnight in the query's time zone.
+static void CompileDayRange(const vector<string> &date_range, const SemanticDimension *dimension, const string &member,
+                            const string &time_zone, const SemanticRollup *rollup,
+                            vector<unique_ptr<ParsedExpression>> &conditions) {
+	D_ASSERT(date_range.size() == 2);
+	auto start = TypedConstant(date_range[0], LogicalType::DATE, member);
+	auto end = TypedConstant(date_range[1], LogicalType::DATE, member);
+	auto &end_value = end->Cast<ConstantExpression>().value;
+	auto end_date = end_value.GetValue<date_t>();
+	// A range of whole days needs finite dates - 'infinity' has no next day
+	if (!Date::IsFinite(start->Cast<ConstantExpression>().value.GetValue<date_t>())) {
+		throw InvalidInputException("Value '%s' for '%s' is not a valid DATE", date_range[0], member);
+	}
+	if (!Date::IsFinite(end_date)) {
+		throw InvalidInputException("Value '%s' for '%s' is not a valid DATE", date_range[1], member);
+	}
+	end_value = Value::DATE(date_t(end_date.days + 1));
+	if (dimension && !rollup && UsesTimeZone(*dimension, time_zone)) {
+		start = ZonedMidnight(std::move(start), time_zone);
+		end = ZonedMidnight(std::move(end), time_zone);
+	}
+	conditions.push_back(make_uniq<ComparisonExpression>(ExpressionType::COMPARE_GREATERTHANOREQUALTO,
+	                                                     FilterOperand(dimension, member, rollup), std::move(start)));
+	conditions.push_back(make_uniq<ComparisonExpression>(ExpressionType::COMPARE_LESSTHAN,
+	                                                     FilterOperand(dimension, member, rollup), std::move(end)));
+}
+
+static unique_ptr<ParsedExpression> CompileConjunction(ExpressionType type,
+                                                       vector<unique_ptr<ParsedExpression>> conditions) {
+	D_ASSERT(!conditions.empty());
+	if (conditions.size() == 1) {
+		return std::move(conditions[0]);
+	}
+	return make_uniq<ConjunctionExpression>(type, std::move(conditions));
+}
+
+// contains() and prefix() are evaluated directly on the string vectors (and prefix() is pushed into scans as a
+// range over the column) - unlike a LIKE pattern built by concatenation
+static unique_ptr<ParsedExpression> CompileStringMatch(const SemanticFilter &filter, const SemanticDimension *dimension,
+                                                       const SemanticRollup *rollup) {
+	auto function_name = filter.operator_ == "starts_with" ? "prefix" : "contains";
+	vector<unique_ptr<ParsedExpression>> matches;
+	for (const auto &value : filter.values) {
+		vector<unique_ptr<ParsedExpression>> children;
+		children.push_back(FilterOperand(dimension, filter.dimension, rollup));
+		children.push_back(make_uniq<ConstantExpression>(Value(value)));
+		matches.push_back(make_uniq<FunctionExpression>(function_name, std::move(children)));
+	}
+	return CompileConjunction(ExpressionType::CONJUNCTION_OR, std::move(matches));
+}
+
+// operand IN (SELECT unnest(<list>)): the values are a single LIST constant, so binding and planning the filter does
+// not grow with the number of values, and the IN is planned as a hash semi-join against the unnested list
+static unique_ptr<ParsedExpression> CompileInListJoin(const SemanticFilter &filter, const SemanticDimension *dimension,
+                                                      const LogicalType &type, const SemanticRollup *rollup) {
+	auto list_type = type.id() == LogicalTypeId::INVALID ? LogicalType::VARCHAR : type;
+	vector<Value> values;
+	values.reserve(filter.values.size());
+	for (const auto &value : filter.values) {
+		auto constant = TypedConstant(value, list_type, filter.dimension);
+		values.push_back(std::move(constant->Cast<ConstantExpression>().value));
+	}
+	vector<unique_ptr<ParsedExpression>> unnest_children;
+	unnest_children.push_back(make_uniq<ConstantExpression>(Value::LIST(list_type, std::move(values))));
+	auto list_node = make_uniq<SelectNode>();
+	list_node->select_list.push_back(make_uniq<FunctionExpression>("unnest", std::move(unnest_children)));
+	list_node->from_table = make_uniq<EmptyTableRef>();
+	auto list_select = make_uniq<SelectStatement>();
+	list_select->node = std::move(list_node);
+
+	auto in_expr = make_uniq<SubqueryExpression>();
+	in_expr->subquery_type = SubqueryType::ANY;
+	in_expr->comparison_type = ExpressionType::COMPARE_EQUAL;
+	in_expr->child = FilterOperand(dimension, filter.dimension, rollup);
+	in_expr->subquery = std::move(list_select);
+	if (filter.operator_ == "not_equals") {
+		return make_uniq<OperatorExpression>(ExpressionType::OPERATOR_NOT, std::move(in_expr));
+	}
+	return std::move(in_expr);
+}
+
+static ExpressionType GetComparisonType(const string &op) {
+	if (op == "equals") {
+		return ExpressionType::COMPARE_EQUAL;
+	}
+	if (op == "not_equals") {
+		return ExpressionType::COMPARE_NOTEQUAL;
+	}
+	if (op == "gt") {
+		return ExpressionType::COMPARE_GREATERTHAN;
+	}
+	if (op == "gte") {
+		return ExpressionType::COMPARE_GREATERTHANOREQUALTO;
+	}
+	if (op == "lt") {
+		return ExpressionType::COMPARE_LESSTHAN;
+	}
+	D_ASSERT(op == "lte");
+	return ExpressionType::COMPARE_LESSTHANOREQUALTO;
+}
+
+// Compiles a filter, or a group of filters, taking the dimensions of its filters from bound.filters - filter_idx is
+// the position of its first filter there. The operators and their values were checked by ValidateQuery.
+static unique_ptr<ParsedExpression> CompileFilter(const SemanticFilter &filter, const BoundSemanticQuery &bound,
+                                                  const string &time_zone, idx_t &filter_idx,
+                                                  const SemanticRollup *rollup) {
+	auto &dataset = *bound.dataset;
+	auto &bound_filters = bound.filters;
+	if (filter.IsGroup()) {
+		vector<unique_ptr<ParsedExpression>> conditions;
+		for (const auto &child : filter.filters) {
+			conditions.push_back(CompileFilter(child, bound, time_zone, filter_idx, rollup));
+		}
+		return CompileConjunction(filter.operator_ == "or" ? ExpressionType::CONJUNCTION_OR
+		                                                   : ExpressionType::CONJUNCTION_AND,
+		                          std::move(conditions));
+	}
+	D_ASSERT(filter_idx < bound_filters.size());
+	auto &dimension_idx = bound_filters[filter_idx++];
+	auto dimension = dimension_idx.IsValid() ? &dataset.dimensions[dimension_idx.GetIndex()] : nullptr;
+	auto type = dimension ? dimension->data_type : LogicalType::VARCHAR;
+	auto &op = filter.operator_;
+
+	if (op == "set" || op == "not_set") {
+		return make_uniq<OperatorExpression>(op == "set" ? ExpressionType::OPERATOR_IS_NOT_NULL
+		                                                 : ExpressionType::OPERATOR_IS_NULL,
+		                                     FilterOperand(dimension, filter.dimension, rollup));
+	}
+	if (op == "contains" || op == "starts_with") {
+		return CompileStringMatch(filter, dimension, rollup);
+	}
+	if (op == "between") {
+		return make_uniq<BetweenExpression>(FilterOperand(dimension, filter.dimension, rollup),
+		                                    TypedConstant(filter.values[0], type, filter.dimension),
+		                                    TypedConstant(filter.values[1], type, filter.dimension));
+	}
+	if (op == "in_date_range") {
+		vector<unique_ptr<ParsedExpression>> conditions;
+		CompileDayRange(filter.values, dimension, filter.dimension, time_zone, rollup, conditions);
+		return CompileConjunction(ExpressionType::CONJUNCTION_AND, std::move(conditions));
+	}
+	if (filter.values.size() == 1) {
+		auto operand = FilterOperand(dimension, filter.dimension, rollup);
+		return make_uniq<ComparisonExpression>(GetComparisonType(op), std::move(operand),
+		                                       TypedConstant(filter.values[0], type, filter.dimension));
+	}
+	// equals / not_equals with several values
+	if (filter.values.size() > bound.in_list_threshold) {
+		return CompileInListJoin(filter, dimension, type, rollup);
+	}
+	auto in_expr =
+	    make_uniq<OperatorExpression>(op == "not_equals" ? ExpressionType::COMPARE_NOT_IN : ExpressionType::COMPARE_IN);
+	in_expr->children.reserve(filter.values.size() + 1);
+	in_expr->children.push_back(FilterOperand(dimension, filter.dimension, rollup));
+	for (const auto &value : filter.values) {
+		in_expr->children.push_back(TypedConstant(value, type, filter.dimension));
+	}
+	return std::move(in_expr);
+}
+
+static void CompileDateRange(const SemanticTimeDimension &time_dim, const SemanticDimension &dimension,
+                             const string &time_zone, const SemanticRollup *rollup,
+                             vector<unique_ptr<ParsedExpression>> &conditions) {
+	// ValidateQuery only lets through date ranges of two dates
+	if (time_dim.date_range.empty()) {
+		return;
+	}
+	D_ASSERT(time_dim.date_range.size() == 2);
+	CompileDayRange(time_dim.date_range, &dimension, time_dim.dimension, time_zone, rollup, conditions);
+}
+
+static const SemanticJoin *FindOneToManyJoin(const SemanticDataset &dataset, const SemanticMeasure &measure) {
+	for (auto join_idx : measure.joins) {
+		if (dataset.joins[join_idx].IsOneToMany()) {
+			return &dataset.joins[join_idx];
+		}
+	}
+	return nullptr;
+}
+
+// The joined table, aliased to the join name that the members refer to
+static unique_ptr<TableRef> JoinedTableRef(const SemanticJoin &join) {
+	auto table_ref = QualifiedTableRef(join.table);
+	if (table_ref->table_name != join.name) {
+		table_ref->alias = join.name;
+	}
+	return std::move(table_ref);
+}
+
+// Column of a pre-aggregated join with the partial aggregate of a measure - named so that it never clashes with the
+// columns of the dataset's table
+static string PartialMeasureColumn(idx_t measure_idx) {
+	return "__measure_" + to_string(measure_idx);
+}
+
+// A one_to_many join, aggregated by its key: one row per key with a column per measure over the join. Joined on the
+// key, it matches at most one row of the dataset like a many_to_one join.
+static unique_ptr<TableRef> CompilePreaggregatedJoin(const SemanticDataset &dataset, const SemanticJoin &join,
+                                                     const vector<idx_t> &measures) {
+	auto node = make_uniq<SelectNode>();
+	GroupingSet grouping_set;
+	for (idx_t i = 0; i < join.table_keys.size(); i++) {
+		auto key = join.table_keys[i]->Copy();
+		node->groups.group_expressions.push_back(key->Copy());
+		grouping_set.insert(i);
+		key->SetAlias("__key_" + to_string(i));
+		node->select_list.push_back(std::move(key));
+	}
+	node->groups.grouping_sets.push_back(std::move(grouping_set));
+	for (auto measure_idx : measures) {
+		auto &measure = dataset.measures[measure_idx];
+		if (FindOneToManyJoin(dataset, measure) == &join) {
+			auto expr = measure.expression->Copy();
+			expr->SetAlias(PartialMeasureColumn(measure_idx));
+			node->select_list.push_back(std::move(expr));
+		}
+	}
+	node->from_table = JoinedTableRef(join);
+	auto select = make_uniq<SelectStatement>();
+	select->node = std::move(node);
+	return make_uniq<SubqueryRef>(std::move(select), join.name);
+}
+
+unique_ptr<TableRef> CompileDatasetSource(const SemanticDataset &dataset, const vector<idx_t> &joins,
+                                          const vector<idx_t> &measures) {
+	unique_ptr<TableRef> source = QualifiedTableRef(dataset.name);
+	for (auto join_idx : joins) {
+		auto &join = dataset.joins[join_idx];
+		auto join_ref = make_uniq<JoinRef>(JoinRefType::REGULAR);
+		// Rows of the dataset without a match keep contributing to its measures
+		join_ref->type = JoinType::LEFT;
+		join_ref->left = std::move(source);
+		if (join.IsOneToMany()) {
+			join_ref->right = CompilePreaggregatedJoin(dataset, join, measures);
+			vector<unique_ptr<ParsedExpression>> conditions;
+			for (idx_t i = 0; i < join.dataset_keys.size(); i++) {
+				auto key = make_uniq<ColumnRefExpression>("__key_" + to_string(i), join.name);
+				conditions.push_back(make_uniq<ComparisonExpression>(ExpressionType::COMPARE_EQUAL,
+				                                                     join.dataset_keys[i]->Copy(), std::move(key)));
+			}
+			join_ref->condition = CompileConjunction(ExpressionType::CONJUNCTION_AND, std::move(conditions));
+		} else {
+			join_ref->right = JoinedTableRef(join);
+			join_ref->condition = join.condition->Copy();
+		}
+		source = std::move(join_ref);
+	}
+	return source;
+}
+
+static void AddJoins(vector<idx_t> &joins, const vector<idx_t> &new_joins) {
+	joins.insert(joins.end(), new_joins.begin(), new_joins.end());
+}
+
+// Filters on a raw column of a join ("customers.segment") need the join as well
+static void AddFilterJoins(const SemanticDataset &dataset, const SemanticFilter &filter, vector<idx_t> &joins) {
+	if (filter.IsGroup()) {
+		for (const auto &child : filter.filters) {
+			AddFilterJoins(dataset, child, joins);
+		}
+		return;
+	}
+	auto separator = filter.dimension.find('.');
+	if (separator == string::npos || dataset.FindDimension(filter.dimension).IsValid()) {
+		return;
+	}
+	auto join_idx = dataset.FindJoin(filter.dimension.substr(0, separator));
+	if (join_idx.IsValid() && !dataset.joins[join_idx.GetIndex()].IsOneToMany()) {
+		joins.push_back(join_idx.GetIndex());
+		AddJoins(joins, dataset.joins[join_idx.GetIndex()].dependencies);
+	}
+}
+
+// Join pruning: only the joins that the measures, dimensions, time dimensions and filters refer to, in declaration
+// order - a query over the columns of the dataset's table reads just that table
+static vector<idx_t> RequiredJoins(const SemanticQuery &query, const BoundSemanticQuery &bound,
+                                   const vector<idx_t> &measures, const vector<idx_t> &dimensions) {
+	auto &dataset = *bound.dataset;
+	vector<idx_t> joins;
+	if (dataset.joins.empty()) {
+		return joins;
+	}
+	for (auto measure_idx : measures) {
+		AddJoins(joins, dataset.measures[measure_idx].joins);
+	}
+	for (auto dimension_idx : dimensions) {
+		AddJoins(joins, dataset.dimensions[dimension_idx].joins);
+	}
+	for (auto dimension_idx : bound.time_dimensions) {
+		AddJoins(joins, dataset.dimensions[dimension_idx].joins);
+	}
+	for (auto &dimension_idx : bound.filters) {
+		if (dimension_idx.IsValid()) {
+			AddJoins(joins, dataset.dimensions[dimension_idx.GetIndex()].joins);
+		}
+	}
+	for (const auto &filter : query.filters) {
+		AddFilterJoins(dataset, filter, joins);
+	}
+	std::sort(joins.begin(), joins.end());
+	joins.erase(std::unique(joins.begin(), joins.end()), joins.end());
+	return joins;
+}
+
+static unique_ptr<TableRef> CompileTableRef(const SemanticQuery &query, const BoundSemanticQuery &bound,
+                                            const vector<idx_t> &measures, const vector<idx_t> &dimensions,
+                                            const SemanticRollup *rollup) {
+	if (rollup) {
+		auto table_ref = make_uniq<BaseTableRef>();
+		table_ref->table_name = rollup->table_name;
+		return std::move(table_ref);
+	}
+	return CompileDatasetSource(*bound.dataset, RequiredJoins(query, bound, measures, dimensions), measures);
+}
+
+// A measure over a one_to_many join combines the partial aggregates of its pre-aggregated join - the counts of keys
+// without rows of the join are 0, not NULL
+static unique_ptr<ParsedExpression> CompileMeasure(const SemanticDataset &dataset, idx_t measure_idx) {
+	auto &measure = dataset.measures[measure_idx];
+	auto join = FindOneToManyJoin(dataset, measure);
+	if (!join) {
+		return measure.expression->Copy();
+	}
+	auto aggregation_type = StringUtil::Lower(measure.aggregation_type);
+	vector<unique_ptr<ParsedExpression>> children;
+	children.push_back(make_uniq<ColumnRefExpression>(PartialMeasureColumn(measure_idx), join->name));
+	auto expr = make_uniq_base<ParsedExpression, FunctionExpression>(
+	    aggregation_type == "count" ? "sum" : aggregation_type, std::move(children));
+	if (aggregation_type != "count") {
+		return expr;
+	}
+	vector<unique_ptr<ParsedExpression>> coalesce_children;
+	coalesce_children.push_back(std::move(expr));
+	coalesce_children.push_back(make_uniq<ConstantExpression>(Value::BIGINT(0)));
+	return make_uniq<OperatorExpression>(ExpressionType::OPERATOR_COALESCE, std::move(coalesce_children));
+}
+
+static unique_ptr<ParsedExpression> CompileWhereClause(const SemanticQuery &query, const BoundSemanticQuery &bound,
+                                                       const SemanticRollup *rollup) {
+	auto &dataset = *bound.dataset;
+	vector<unique_ptr<ParsedExpression>> where_conditions;
+
+	// Add regular filters
+	idx_t filter_idx = 0;
+	for (const auto &filter : query.filters) {
+		where_conditions.push_back(CompileFilter(filter, bound, query.time_zone, filter_idx, rollup));
+	}
+	D_ASSERT(filter_idx == bound.filters.size());
+
+	// Add time dimension filters
+	for (idx_t i = 0; i < query.time_dimensions.size(); i++) {
+		CompileDateRange(query.time_dimensions[i], dataset.dimensions[bound.time_dimensions[i]], query.time_zone,
+		                 rollup, where_conditions);
+	}
+
+	if (where_conditions.empty()) {
+		return nullptr;
+	}
+	if (where_conditions.size() == 1) {
+		return std::move(where_conditions[0]);
+	}
+	return make_uniq<ConjunctionExpression>(ExpressionType::CONJUNCTION_AND, std::move(where_conditions));
+}
+
+// Query Compilation Function
+// Builds the SELECT node directly rather than SQL text, so binding a semantic query never goes through the parser.
+// Member expressions are parsed once at registration and copied here; filter values become typed constants.
+// Members are taken from the indexes resolved by DatasetRegistry::ValidateQuery, so nothing is looked up by name.
+// A query routed to a rollup reads the rollup table, whose columns are named after the members.
+unique_ptr<SelectNode> CompileSemanticQuery(const SemanticQuery &query, const BoundSemanticQuery &bound) {
+	D_ASSERT(bound.dataset);
+	D_ASSERT(bound.time_dimensions.size() == query.time_dimensions.size());
+	auto &dataset = *bound.dataset;
+	auto rollup = bound.rollup.IsValid() ? &dataset.rollups[bound.rollup.GetIndex()] : nullptr;
+
+	auto node = make_uniq<SelectNode>();
+	vector<unique_ptr<ParsedExpression>> group_expressions;
+
+	// Add measures
+	for (auto measure_idx : bound.measures) {
+		auto &measure = dataset.measures[measure_idx];
+		auto expr =
+		    rollup ? CompileRollupMeasure(measure, bound.reaggregate_rollup) : CompileMeasure(dataset, measure_idx);
+		expr->SetAlias(measure.name);
+		node->select_list.push_back(std::move(expr));
+	}
+
+	// Add dimensions
+	for (auto dimension_idx : bound.dimensions) {
+		auto &dimension = dataset.dimensions[dimension_idx];
+		auto expr = rollup ? make_uniq_base<ParsedExpression, ColumnRefExpression>(dimension.name)
+		                   : dimension.expression->Copy();
+		group_expressions.push_back(expr->Copy());
+		expr->SetAlias(dimension.name);
+		node->select_list.push_back(std::move(expr));
+	}
+
+	// Add time dimensions with granularity
+	node->from_table = CompileTableRef(query, bound, bound.measures, bound.dimensions, rollup);
+	for (idx_t i = 0; i < query.time_dimensions.size(); i++) {
+		auto time_expr = CompileTimeExpression(dataset, dataset.dimensions[bound.time_dimensions[i]], query, i,
+		                                       rollup, node->from_table);
+		group_expressions.push_back(time_expr->Copy());
+		time_expr->SetAlias(query.time_dimensions[i].dimension);
+		node->select_list.push_back(std::move(time_expr));
+	}
+
+	if (node->select_list.empty()) {
+		throw InvalidInputException("No valid measures or dimensions specified");
+	}
+
+	node->where_clause = CompileWhereClause(query, bound, rollup);
+
+	// Add GROUP BY clause (if we have measures) - a rollup with exactly the query grouping has one row per group
+	bool grouped = !rollup || bound.reaggregate_rollup;
+	if (!query.measures.empty() && !group_expressions.empty() && grouped) {
+		GroupingSet grouping_set;
+		for (idx_t i = 0; i < group_expressions.size(); i++) {
+			grouping_set.insert(i);
+		}
+		node->groups.group_expressions = std::move(group_expressions);
+		node->groups.grouping_sets.push_back(std::move(grouping_set));
+	}
+
+	// Add ORDER BY clause - on the projected aliases, in the same SELECT as the aggregate and the LIMIT, so the
+	// optimizer plans "top N groups by a measure" as a heap-based TOP_N over the aggregate instead of a full sort
+	if (!query.order.empty()) {
+		auto order_modifier = make_uniq<OrderModifier>();
+		for (const auto &order : query.order) {
+			order_modifier->orders.emplace_back(order.desc ? OrderType::DESCENDING : OrderType::ORDER_DEFAULT,
+			                                    OrderByNullType::ORDER_DEFAULT,
+			                                    make_uniq<ColumnRefExpression>(order.id));
+		}
+		node->modifiers.push_back(std::move(order_modifier));
+	}
+
+	// Add LIMIT clause
+	if (query.limit > 0) {
+		auto limit_modifier = make_uniq<LimitModifier>();
+		limit_modifier->limit = make_uniq<ConstantExpression>(Value::BIGINT(query.limit));
+		node->modifiers.push_back(std::move(limit_modifier));
+	}
+
+	return node;
+}
+
+// Shared scan for a group of batched queries, which have the same dataset, filters and time dimensions. Each query
+// becomes a grouping set over its dimensions and the time dimensions. The __grouping_id column is GROUPING() over
+// the group's dimensions, in order, so it tells which grouping set a row belongs to.
+unique_ptr<SelectNode> CompileSemanticQueryGroup(const vector<SemanticQuery> &queries,
+                                                 const vector<BoundSemanticQuery> &bound,
+                                                 const SemanticQueryGroup &group) {
+	D_ASSERT(!group.queries.empty());
+	auto &query = queries[group.queries[0]];
+	auto &query_bound = bound[group.queries[0]];
+	auto &dataset = *query_bound.dataset;
+
+	auto node = make_uniq<SelectNode>();
+	for (auto measure_idx : group.measures) {
+		auto &measure = dataset.measures[measure_idx];
+		auto expr = CompileMeasure(dataset, measure_idx);
+		expr->SetAlias(measure.name);
+		node->select_list.push_back(std::move(expr));
+	}
+
+	vector<unique_ptr<ParsedExpression>> group_expressions;
+	auto grouping_id = make_uniq<OperatorExpression>(ExpressionType::GROUPING_FUNCTION);
+	for (auto dimension_idx : group.dimensions) {
+		auto &dimension = dataset.dimensions[dimension_idx];
+		auto expr = dimension.expression->Copy();
+		group_expressions.push_back(expr->Copy());
+		grouping_id->children.push_back(expr->Copy());
+		expr->SetAlias(dimension.name);
+		node->select_list.push_back(std::move(expr));
+	}
+	node->from_table = CompileTableRef(query, query_bound, group.measures, group.dimensions, nullptr);
+	for (idx_t i = 0; i < query.time_dimensions.size(); i++) {
+		auto time_expr = CompileTimeExpression(dataset, dataset.dimensions[query_bound.time_dimensions[i]], query, i,
+		                                       nullptr, node->from_table);
+		group_expressions.push_back(time_expr->Copy());
+		time_expr->SetAlias(query.time_dimensions[i].dimension);
+		node->select_list.push_back(std::move(time_expr));
+	}
+	if (group.dimensions.empty()) {
+		// Every query of the group aggregates over the same (time) grouping
+		auto constant = make_uniq<ConstantExpression>(Value::BIGINT(0));
+		constant->SetAlias("__grouping_id");
+		node->select_list.push_back(std::move(constant));
+	} else {
+		grouping_id->SetAlias("__grouping_id");
+		node->select_list.push_back(std::move(grouping_id));
+	}
+
+	node->where_clause = CompileWhereClause(query, query_bound, nullptr);
+
+	if (!group_expressions.empty()) {
+		for (auto query_idx : group.queries) {
+			GroupingSet grouping_set;
+			for (idx_t i = group.dimensions.size(); i < group_expressions.size(); i++) {
+				grouping_set.insert(i);
+			}
+			for (auto dimension_idx : bound[query_idx].dimensions) {
+				auto entry = std::find(group.dimensions.begin(), group.dimensions.end(), dimension_idx);
+				grouping_set.insert(NumericCast<idx_t>(entry - group.dimensions.begin()));
+			}
+			auto &grouping_sets = node->groups.grouping_sets;
+			if (std::find(grouping_sets.begin(), grouping_sets.end(), grouping_set) == grouping_sets.end()) {
+				grouping_sets.push_back(std::move(grouping_set));
+			}
+		}
+		node->groups.group_expressions = std::move(group_expressions);
+	}
+	return node;
+}
+
+string CompileSemanticQueryToSQL(const SemanticQuery &query, const BoundSemanticQuery &bound) {
+	return CompileSemanticQuery(query, bound)->ToString();
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
@@ -0,0 +1,126 @@
+#include "quack_extension.hpp"
+#include "duckdb/common/error_data.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/file_system.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/extension_util.hpp"
+#include "duckdb/parallel/task_executor.hpp"
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+// register_datasets(glob) reads one dataset definition per file, parses the files in parallel on the DuckDB task
+// scheduler and registers all of them with a single registry swap (and a single persistence transaction).
+struct RegisterDatasetsData : public TableFunctionData {
+	vector<string> files;
+};
+
+struct RegisterDatasetsState : public GlobalTableFunctionState {
+	bool registered = false;
+	//! Datasets registered, with the file they came from, for the output
+	vector<pair<string, string>> registered_datasets;
+	idx_t offset = 0;
+};
+
+// Glob results are OpenFileInfo entries since DuckDB v1.3, plain paths before
+static string GetGlobbedPath(const string &file) {
+	return file;
+}
+
+template <class T>
+static string GetGlobbedPath(const T &file) {
+	return file.path;
+}
+
+static string ReadDefinitionFile(FileSystem &fs, const string &path) {
+	auto handle = fs.OpenFile(path, FileFlags::FILE_FLAGS_READ);
+	auto file_size = NumericCast<idx_t>(handle->GetFileSize());
+	string contents(file_size, '\0');
+	handle->Read((void *)contents.data(), file_size);
+	return contents;
+}
+
+class ParseDatasetFileTask : public BaseExecutorTask {
+public:
+	ParseDatasetFileTask(TaskExecutor &executor, FileSystem &fs, const string &path,
+	                     shared_ptr<SemanticDataset> &result)
+	    : BaseExecutorTask(executor), fs(fs), path(path), result(result) {
+	}
+
+	void ExecuteTask() override {
+		try {
+			result = ParseSemanticDataset(string(), ReadDefinitionFile(fs, path));
+		} catch (const std::exception &e) {
+			ErrorData error(e);
+			throw InvalidInputException("Failed to register dataset from \"%s\": %s", path, error.Message());
+		}
+	}
+
+private:
+	FileSystem &fs;
+	const string &path;
+	//! Slot for this file in the shared result vector - each task writes only its own slot
+	shared_ptr<SemanticDataset> &result;
+};
+
+static unique_ptr<FunctionData> RegisterDatasetsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                     vector<LogicalType> &return_types, vector<string> &names) {
+	auto pattern = input.inputs[0].GetValue<string>();
+	auto &fs = FileSystem::GetFileSystem(context);
+	auto result = make_uniq<RegisterDatasetsData>();
+	for (auto &file : fs.GlobFiles(pattern, context, FileGlobOptions::DISALLOW_EMPTY)) {
+		result->files.push_back(GetGlobbedPath(file));
+	}
+
+	names = {"dataset", "file"};
+	return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR};
+	return std::move(result);
+}
+
+static unique_ptr<GlobalTableFunctionState> RegisterDatasetsInit(ClientContext &context,
+                                                                 TableFunctionInitInput &input) {
+	return make_uniq<RegisterDatasetsState>();
+}
+
+static void RegisterDatasetsFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->Cast<RegisterDatasetsData>();
+	auto &state = data_p.global_state->Cast<RegisterDatasetsState>();
+
+	if (!state.registered) {
+		state.registered = true;
+		auto &fs = FileSystem::GetFileSystem(context);
+		vector<shared_ptr<SemanticDataset>> datasets(data.files.size());
+		TaskExecutor executor(context);
+		for (idx_t i = 0; i < data.files.size(); i++) {
+			executor.ScheduleTask(make_uniq<ParseDatasetFileTask>(executor, fs, data.files[i], datasets[i]));
+		}
+		executor.WorkOnTasks();
+
+		state.registered_datasets.reserve(datasets.size());
+		for (idx_t i = 0; i < datasets.size(); i++) {
+			state.registered_datasets.emplace_back(datasets[i]->name, data.files[i]);
+		}
+		DatasetRegistry::Get(context).RegisterDatasets(*context.db, std::move(datasets));
+	}
+
+	idx_t count = 0;
+	while (state.offset < state.registered_datasets.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &entry = state.registered_datasets[state.offset++];
+		output.SetValue(0, count, Value(entry.first));
+		output.SetValue(1, count, Value(entry.second));
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+void RegisterBulkDatasetRegistrationFunctions(DatabaseInstance &instance) {
+	TableFunction register_datasets("register_datasets", {LogicalType::VARCHAR}, RegisterDatasetsFunction,
+	                                RegisterDatasetsBind, RegisterDatasetsInit);
+	ExtensionUtil::RegisterFunction(instance, register_datasets);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
@@ -0,0 +1,956 @@
+#include "quack_extension.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/limits.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/common/string_util.hpp"
+#ifdef HAVE_NLOHMANN_JSON
+#include <nlohmann/json.hpp>
+#endif
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+using json = nlohmann::json;
+
+// Semantic queries and dataset definitions are parsed with SAX handlers that fill the semantic structs directly.
+// No json DOM is built, and strings are moved out of the parser's token buffer instead of being copied out of a tree.
+// Unknown keys are skipped (including nested objects and arrays), as they were ignored by the DOM-based parser.
+// Note that json_sax declares string() and key() callbacks, so the handlers spell the type as std::string.
+class SemanticJSONHandler : public json::json_sax_t {
+public:
+	explicit SemanticJSONHandler(const char *document) : document(document) {
+	}
+
+	bool binary(binary_t &val) override {
+		return Skipping() || UnexpectedValue("binary value");
+	}
+
+	bool key(string_t &val) override {
+		if (!Skipping()) {
+			current_key = std::move(val);
+		}
+		return true;
+	}
+
+	bool parse_error(std::size_t position, const std::string &last_token,
+	                 const nlohmann::detail::exception &ex) override {
+		throw InvalidInputException("Invalid JSON in %s: %s", document, ex.what());
+	}
+
+protected:
+	[[noreturn]] void Error(const std::string &message) {
+		throw InvalidInputException("Invalid JSON in %s: %s", document, message);
+	}
+
+	bool UnexpectedValue(const char *value_type) {
+		if (current_key.empty()) {
+			Error(StringUtil::Format("unexpected %s", value_type));
+		}
+		Error(StringUtil::Format("unexpected %s for \"%s\"", value_type, current_key));
+	}
+
+	//! Whether the handler is inside a value that is being skipped
+	bool Skipping() const {
+		return skip_depth > 0;
+	}
+
+	//! Skip the object or array that was just started
+	bool StartSkipping() {
+		skip_depth = 1;
+		return true;
+	}
+
+	//! Handle a start_object/start_array event while skipping
+	bool SkipNested() {
+		skip_depth++;
+		return true;
+	}
+
+	//! Handle an end_object/end_array event, returns true if it closed a skipped value
+	bool SkipEnd() {
+		if (skip_depth == 0) {
+			return false;
+		}
+		skip_depth--;
+		return true;
+	}
+
+	//! Whether the current key is one of the given member names
+	bool KeyIsOneOf(std::initializer_list<const char *> names) const {
+		for (auto member_name : names) {
+			if (current_key == member_name) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static int64_t ToInteger(number_unsigned_t val) {
+		if (val > static_cast<number_unsigned_t>(NumericLimits<int64_t>::Maximum())) {
+			throw InvalidInputException("Integer value %s is out of range", std::to_string(val));
+		}
+		return static_cast<int64_t>(val);
+	}
+
+protected:
+	const char *document;
+	//! Most recent object key - only meaningful for the value that directly follows it
+	std::string current_key;
+
+private:
+	idx_t skip_depth = 0;
+};
+
+//===--------------------------------------------------------------------===//
+// Semantic queries
+//===--------------------------------------------------------------------===//
+class SemanticQueryHandler : public SemanticJSONHandler {
+public:
+	explicit SemanticQueryHandler(SemanticQuery &query) : SemanticJSONHandler("semantic query"), query(query) {
+	}
+
+	bool null() override {
+		// A null value is treated like an absent key
+		return Skipping() || Top().type != FrameType::STRING_LIST || UnexpectedValue("null");
+	}
+
+	bool boolean(bool val) override {
+		if (Skipping()) {
+			return true;
+		}
+		if (Top().type == FrameType::ORDER && current_key == "desc") {
+			query.order.back().desc = val;
+			return true;
+		}
+		return IgnoreScalar("boolean");
+	}
+
+	bool number_integer(number_integer_t val) override {
+		if (Skipping()) {
+			return true;
+		}
+		if (Top().type == FrameType::ROOT && current_key == "limit") {
+			query.limit = val;
+			return true;
+		}
+		return IgnoreScalar("number");
+	}
+
+	bool number_unsigned(number_unsigned_t val) override {
+		if (Skipping()) {
+			return true;
+		}
+		if (Top().type == FrameType::ROOT && current_key == "limit") {
+			query.limit = ToInteger(val);
+			return true;
+		}
+		return IgnoreScalar("number");
+	}
+
+	bool number_float(number_float_t val, const string_t &s) override {
+		return Skipping() || IgnoreScalar("number");
+	}
+
+	bool string(string_t &val) override {
+		if (Skipping()) {
+			return true;
+		}
+		auto &frame = Top();
+		switch (frame.type) {
+		case FrameType::ROOT:
+			if (current_key == "dataset") {
+				query.dataset = std::move(val);
+				return true;
+			}
+			if (current_key == "time_zone") {
+				query.time_zone = std::move(val);
+				return true;
+			}
+			break;
+		case FrameType::STRING_LIST:
+			frame.strings->push_back(std::move(val));
+			return true;
+		case FrameType::FILTER:
+			if (current_key == "dimension") {
+				frame.filter->dimension = std::move(val);
+				return true;
+			}
+			if (current_key == "operator") {
+				frame.filter->operator_ = std::move(val);
+				return true;
+			}
+			break;
+		case FrameType::TIME_DIMENSION:
+			if (current_key == "dimension") {
+				query.time_dimensions.back().dimension = std::move(val);
+				return true;
+			}
+			if (current_key == "granularity") {
+				query.time_dimensions.back().granularity = std::move(val);
+				return true;
+			}
+			break;
+		case FrameType::ORDER:
+			if (current_key == "id") {
+				query.order.back().id = std::move(val);
+				return true;
+			}
+			break;
+		default:
+			break;
+		}
+		return IgnoreScalar("string");
+	}
+
+	bool start_object(std::size_t elements) override {
+		if (Skipping()) {
+			return SkipNested();
+		}
+		if (frames.empty()) {
+			frames.push_back(Frame(FrameType::ROOT));
+			return true;
+		}
+		switch (frames.back().type) {
+		case FrameType::FILTER_LIST: {
+			auto &filters = *frames.back().filters;
+			filters.emplace_back();
+			frames.push_back(Frame(filters.back()));
+			return true;
+		}
+		case FrameType::TIME_DIMENSION_LIST:
+			query.time_dimensions.emplace_back();
+			frames.push_back(Frame(FrameType::TIME_DIMENSION));
+			return true;
+		case FrameType::ORDER_LIST:
+			query.order.emplace_back();
+			frames.push_back(Frame(FrameType::ORDER));
+			return true;
+		case FrameType::STRING_LIST:
+			return UnexpectedValue("object");
+		default:
+			if (IsKnownKey()) {
+				return UnexpectedValue("object");
+			}
+			return StartSkipping();
+		}
+	}
+
+	bool end_object() override {
+		if (SkipEnd()) {
+			return true;
+		}
+		switch (frames.back().type) {
+		case FrameType::FILTER: {
+			auto &filter = *frames.back().filter;
+			if (filter.IsGroup()) {
+				if (filter.filters.empty()) {
+					Error(StringUtil::Format("\"%s\" filter group is empty", filter.operator_));
+				}
+				if (!filter.dimension.empty()) {
+					Error("a filter is either a dimension filter or an \"and\"/\"or\" group");
+				}
+				break;
+			}
+			RequireField(filter.dimension, "filter", "dimension");
+			RequireField(filter.operator_, "filter", "operator");
+			break;
+		}
+		case FrameType::TIME_DIMENSION:
+			RequireField(query.time_dimensions.back().dimension, "time dimension", "dimension");
+			break;
+		case FrameType::ORDER:
+			RequireField(query.order.back().id, "order", "id");
+			break;
+		default:
+			break;
+		}
+		frames.pop_back();
+		return true;
+	}
+
+	bool start_array(std::size_t elements) override {
+		if (Skipping()) {
+			return SkipNested();
+		}
+		auto type = Top().type;
+		if (type == FrameType::ROOT) {
+			if (current_key == "measures") {
+				frames.push_back(Frame(FrameType::STRING_LIST, &query.measures));
+				return true;
+			}
+			if (current_key == "dimensions") {
+				frames.push_back(Frame(FrameType::STRING_LIST, &query.dimensions));
+				return true;
+			}
+			if (current_key == "filters") {
+				frames.push_back(Frame(query.filters));
+				return true;
+			}
+			if (current_key == "time_dimensions") {
+				frames.push_back(Frame(FrameType::TIME_DIMENSION_LIST));
+				return true;
+			}
+			if (current_key == "order") {
+				frames.push_back(Frame(FrameType::ORDER_LIST));
+				return true;
+			}
+		} else if (type == FrameType::FILTER && current_key == "values") {
+			frames.push_back(Frame(FrameType::STRING_LIST, &Top().filter->values));
+			return true;
+		} else if (type == FrameType::FILTER && KeyIsOneOf({"and", "or"})) {
+			// {"or": [filter, ...]} - a group is a filter whose operator is "and" or "or"
+			auto &filter = *Top().filter;
+			if (!filter.operator_.empty() || !filter.dimension.empty()) {
+				Error("a filter is either a dimension filter or an \"and\"/\"or\" group");
+			}
+			filter.operator_ = current_key;
+			frames.push_back(Frame(filter.filters));
+			return true;
+		} else if (type == FrameType::TIME_DIMENSION && current_key == "date_range") {
+			frames.push_back(Frame(FrameType::STRING_LIST, &query.time_dimensions.back().date_range));
+			return true;
+		}
+		if (type == FrameType::STRING_LIST || IsKnownKey()) {
+			return UnexpectedValue("array");
+		}
+		return StartSkipping();
+	}
+
+	bool end_array() override {
+		if (SkipEnd()) {
+			return true;
+		}
+		frames.pop_back();
+		return true;
+	}
+
+	void Finalize() {
+		if (!frames.empty()) {
+			Error("unexpected end of input");
+		}
+	}
+
+private:
+	enum class FrameType : uint8_t {
+		ROOT,
+		STRING_LIST,
+		FILTER_LIST,
+		FILTER,
+		TIME_DIMENSION_LIST,
+		TIME_DIMENSION,
+		ORDER_LIST,
+		ORDER
+	};
+
+	struct Frame {
+		explicit Frame(FrameType type, vector<std::string> *strings = nullptr) : type(type), strings(strings) {
+		}
+		explicit Frame(vector<SemanticFilter> &filters) : type(FrameType::FILTER_LIST), filters(&filters) {
+		}
+		explicit Frame(SemanticFilter &filter) : type(FrameType::FILTER), filter(&filter) {
+		}
+		FrameType type;
+		//! Target of a STRING_LIST frame
+		vector<std::string> *strings = nullptr;
+		//! Target of a FILTER_LIST frame - the query's filters or those of a filter group
+		vector<SemanticFilter> *filters = nullptr;
+		//! Target of a FILTER frame
+		SemanticFilter *filter = nullptr;
+	};
+
+	Frame &Top() {
+		if (frames.empty()) {
+			Error("expected a JSON object");
+		}
+		return frames.back();
+	}
+
+	//! Whether the current key names a member of the current object (so its value must have the right type)
+	bool IsKnownKey() const {
+		switch (frames.back().type) {
+		case FrameType::ROOT:
+			return KeyIsOneOf({"dataset", "measures", "dimensions", "filters", "time_dimensions", "order", "limit",
+			                   "time_zone"});
+		case FrameType::FILTER:
+			return KeyIsOneOf({"dimension", "operator", "values", "and", "or"});
+		case FrameType::TIME_DIMENSION:
+			return KeyIsOneOf({"dimension", "granularity", "date_range"});
+		case FrameType::ORDER:
+			return KeyIsOneOf({"id", "desc"});
+		default:
+			return false;
+		}
+	}
+
+	//! Scalar that did not match a known member - fine for unknown keys, a type error otherwise
+	bool IgnoreScalar(const char *value_type) {
+		auto type = Top().type;
+		if (type == FrameType::STRING_LIST || type == FrameType::FILTER_LIST ||
+		    type == FrameType::TIME_DIMENSION_LIST || type == FrameType::ORDER_LIST || IsKnownKey()) {
+			return UnexpectedValue(value_type);
+		}
+		return true;
+	}
+
+	void RequireField(const std::string &value, const char *object, const char *field) {
+		if (value.empty()) {
+			Error(StringUtil::Format("%s is missing \"%s\"", object, field));
+		}
+	}
+
+private:
+	SemanticQuery &query;
+	vector<Frame> frames;
+};
+
+SemanticQuery ParseSemanticQuery(const string &json_str) {
+	SemanticQuery query;
+	query.limit = -1; // No limit
+	SemanticQueryHandler handler(query);
+	json::sax_parse(json_str, &handler);
+	handler.Finalize();
+	return query;
+}
+
+// A JSON array of semantic queries - each element is parsed by its own SemanticQueryHandler
+class SemanticQueryBatchHandler : public SemanticJSONHandler {
+public:
+	explicit SemanticQueryBatchHandler(vector<SemanticQuery> &queries)
+	    : SemanticJSONHandler("semantic query batch"), queries(queries) {
+	}
+
+	bool null() override {
+		return Element().null();
+	}
+	bool boolean(bool val) override {
+		return Element().boolean(val);
+	}
+	bool number_integer(number_integer_t val) override {
+		return Element().number_integer(val);
+	}
+	bool number_unsigned(number_unsigned_t val) override {
+		return Element().number_unsigned(val);
+	}
+	bool number_float(number_float_t val, const string_t &s) override {
+		return Element().number_float(val, s);
+	}
+	bool string(string_t &val) override {
+		return Element().string(val);
+	}
+	bool binary(binary_t &val) override {
+		return Element().binary(val);
+	}
+	bool key(string_t &val) override {
+		return Element().key(val);
+	}
+
+	bool start_object(std::size_t elements) override {
+		if (!in_array) {
+			Error("expected an array of semantic queries");
+		}
+		if (depth == 0) {
+			current = SemanticQuery();
+			current.limit = -1; // No limit
+			handler = make_uniq<SemanticQueryHandler>(current);
+		}
+		depth++;
+		return handler->start_object(elements);
+	}
+
+	bool end_object() override {
+		auto result = handler->end_object();
+		if (--depth == 0) {
+			handler->Finalize();
+			handler.reset();
+			queries.push_back(std::move(current));
+		}
+		return result;
+	}
+
+	bool start_array(std::size_t elements) override {
+		if (!in_array) {
+			if (done) {
+				Error("expected an array of semantic queries");
+			}
+			in_array = true;
+			return true;
+		}
+		depth++;
+		return Element().start_array(elements);
+	}
+
+	bool end_array() override {
+		if (depth == 0) {
+			in_array = false;
+			done = true;
+			return true;
+		}
+		depth--;
+		return handler->end_array();
+	}
+
+	void Finalize() {
+		if (!done) {
+			Error("expected an array of semantic queries");
+		}
+	}
+
+private:
+	SemanticQueryHandler &Element() {
+		if (!handler) {
+			Error("expected an array of semantic queries");
+		}
+		return *handler;
+	}
+
+	vector<SemanticQuery> &queries;
+	SemanticQuery current;
+	unique_ptr<SemanticQueryHandler> handler;
+	bool in_array = false;
+	bool done = false;
+	//! Nesting depth inside the current element
+	idx_t depth = 0;
+};
+
+vector<SemanticQuery> ParseSemanticQueryBatch(const string &json_str) {
+	vector<SemanticQuery> queries;
+	SemanticQueryBatchHandler handler(queries);
+	json::sax_parse(json_str, &handler);
+	handler.Finalize();
+	return queries;
+}
+
+//===--------------------------------------------------------------------===//
+// Dataset definitions
+//===--------------------------------------------------------------------===//
+class SemanticDatasetHandler : public SemanticJSONHandler {
+public:
+	SemanticDatasetHandler() : SemanticJSONHandler("dataset definition") {
+	}
+
+	bool null() override {
+		return Skipping() || Top().type != FrameType::STRING_LIST || UnexpectedValue("null");
+	}
+
+	bool boolean(bool val) override {
+		return Skipping() || IgnoreScalar("boolean");
+	}
+
+	bool number_integer(number_integer_t val) override {
+		if (Skipping()) {
+			return true;
+		}
+		if (Top().type == FrameType::ROOT && current_key == "result_cache_ttl") {
+			Error("\"result_cache_ttl\" must be non-negative");
+		}
+		if (Top().type == FrameType::ROOT && current_key == "fiscal_year_start_month") {
+			return SetFiscalYearStartMonth(0);
+		}
+		if (IsPercentile()) {
+			return SetPercentile(static_cast<double>(val));
+		}
+		return IgnoreScalar("number");
+	}
+
+	bool number_unsigned(number_unsigned_t val) override {
+		if (Skipping()) {
+			return true;
+		}
+		if (Top().type == FrameType::ROOT && current_key == "result_cache_ttl") {
+			result_cache_ttl = NumericCast<idx_t>(ToInteger(val));
+			return true;
+		}
+		if (Top().type == FrameType::ROOT && current_key == "fiscal_year_start_month") {
+			return SetFiscalYearStartMonth(val);
+		}
+		if (IsPercentile()) {
+			return SetPercentile(static_cast<double>(val));
+		}
+		return IgnoreScalar("number");
+	}
+
+	bool number_float(number_float_t val, const string_t &s) override {
+		if (Skipping()) {
+			return true;
+		}
+		if (IsPercentile()) {
+			return SetPercentile(val);
+		}
+		return IgnoreScalar("number");
+	}
+
+	bool string(string_t &val) override {
+		if (Skipping()) {
+			return true;
+		}
+		auto &frame = Top();
+		switch (frame.type) {
+		case FrameType::ROOT:
+			if (current_key == "name") {
+				name = std::move(val);
+				return true;
+			}
+			if (current_key == "refresh_key") {
+				refresh_key = std::move(val);
+				return true;
+			}
+			if (current_key == "calendar_table") {
+				calendar_table = std::move(val);
+				return true;
+			}
+			break;
+		case FrameType::MEMBER:
+			if (current_key == "name") {
+				member_name = std::move(val);
+				return true;
+			}
+			if (current_key == "sql") {
+				member_sql = std::move(val);
+				return true;
+			}
+			if (current_key == "type") {
+				member_type = std::move(val);
+				return true;
+			}
+			break;
+		case FrameType::ROLLUP:
+			if (current_key == "name") {
+				rollups.back().name = std::move(val);
+				return true;
+			}
+			if (current_key == "time_dimension") {
+				rollups.back().time_dimension = std::move(val);
+				return true;
+			}
+			if (current_key == "granularity") {
+				rollups.back().granularity = std::move(val);
+				return true;
+			}
+			break;
+		case FrameType::JOIN:
+			if (current_key == "name") {
+				joins.back().name = std::move(val);
+				return true;
+			}
+			if (current_key == "table") {
+				joins.back().table = std::move(val);
+				return true;
+			}
+			if (current_key == "sql_on") {
+				joins.back().sql_on = std::move(val);
+				return true;
+			}
+			if (current_key == "relationship") {
+				joins.back().relationship = std::move(val);
+				return true;
+			}
+			if (current_key == "refresh_key") {
+				joins.back().refresh_key = std::move(val);
+				return true;
+			}
+			break;
+		case FrameType::STRING_LIST:
+			frame.strings->push_back(std::move(val));
+			return true;
+		default:
+			break;
+		}
+		return IgnoreScalar("string");
+	}
+
+	bool start_object(std::size_t elements) override {
+		if (Skipping()) {
+			return SkipNested();
+		}
+		if (frames.empty()) {
+			frames.push_back(Frame(FrameType::ROOT));
+			return true;
+		}
+		switch (frames.back().type) {
+		case FrameType::MEMBER_LIST:
+			member_name.clear();
+			member_sql.clear();
+			member_type.clear();
+			member_percentile = SemanticMeasure::DEFAULT_PERCENTILE;
+			frames.push_back(Frame(FrameType::MEMBER));
+			return true;
+		case FrameType::ROLLUP_LIST:
+			rollups.emplace_back();
+			frames.push_back(Frame(FrameType::ROLLUP));
+			return true;
+		case FrameType::JOIN_LIST:
+			joins.emplace_back();
+			frames.push_back(Frame(FrameType::JOIN));
+			return true;
+		case FrameType::ROOT:
+		case FrameType::MEMBER:
+		case FrameType::ROLLUP:
+		case FrameType::JOIN:
+			if (IsKnownKey()) {
+				return UnexpectedValue("object");
+			}
+			return StartSkipping();
+		default:
+			return UnexpectedValue("object");
+		}
+	}
+
+	bool end_object() override {
+		if (SkipEnd()) {
+			return true;
+		}
+		switch (frames.back().type) {
+		case FrameType::ROOT:
+			done = true;
+			break;
+		case FrameType::MEMBER:
+			AddMember();
+			break;
+		case FrameType::ROLLUP:
+			if (rollups.back().name.empty()) {
+				Error("rollup is missing \"name\"");
+			}
+			break;
+		case FrameType::JOIN:
+			AddJoin();
+			break;
+		default:
+			break;
+		}
+		frames.pop_back();
+		return true;
+	}
+
+	bool start_array(std::size_t elements) override {
+		if (Skipping()) {
+			return SkipNested();
+		}
+		auto type = Top().type;
+		if (type == FrameType::ROOT) {
+			if (current_key == "measures") {
+				return StartMemberList(MemberKind::MEASURE);
+			}
+			if (current_key == "dimensions") {
+				return StartMemberList(MemberKind::DIMENSION);
+			}
+			if (current_key == "time_dimensions") {
+				return StartMemberList(MemberKind::TIME_DIMENSION);
+			}
+			if (current_key == "rollups") {
+				frames.push_back(Frame(FrameType::ROLLUP_LIST));
+				return true;
+			}
+			if (current_key == "joins") {
+				frames.push_back(Frame(FrameType::JOIN_LIST));
+				return true;
+			}
+		} else if (type == FrameType::ROLLUP) {
+			if (current_key == "measures") {
+				frames.push_back(Frame(FrameType::STRING_LIST, &rollups.back().measures));
+				return true;
+			}
+			if (current_key == "dimensions") {
+				frames.push_back(Frame(FrameType::STRING_LIST, &rollups.back().dimensions));
+				return true;
+			}
+		}
+		if ((type == FrameType::ROOT || type == FrameType::MEMBER || type == FrameType::ROLLUP ||
+		     type == FrameType::JOIN) &&
+		    !IsKnownKey()) {
+			return StartSkipping();
+		}
+		return UnexpectedValue("array");
+	}
+
+	bool end_array() override {
+		if (SkipEnd()) {
+			return true;
+		}
+		frames.pop_back();
+		return true;
+	}
+
+	shared_ptr<SemanticDataset> Finalize(const std::string &name_p, const std::string &definition_json) {
+		if (!done) {
+			Error("unexpected end of input");
+		}
+		auto dataset_name = name_p;
+		if (dataset_name.empty()) {
+			if (name.empty()) {
+				throw InvalidInputException("Dataset definition has no \"name\"");
+			}
+			dataset_name = std::move(name);
+		}
+		// Time dimensions follow the regular dimensions regardless of their order in the definition
+		for (auto &time_dimension : time_dimensions) {
+			dimensions.push_back(std::move(time_dimension));
+		}
+		auto dataset = make_shared_ptr<SemanticDataset>(dataset_name, std::move(measures), std::move(dimensions),
+		                                                std::move(rollups), std::move(joins));
+		if (!refresh_key.empty()) {
+			// Only checked here, refreshes use the SQL text
+			ParseSemanticExpression(refresh_key);
+			dataset->refresh_key = std::move(refresh_key);
+		}
+		dataset->result_cache_ttl = result_cache_ttl;
+		dataset->fiscal_year_start_month = fiscal_year_start_month;
+		dataset->calendar_table = std::move(calendar_table);
+		dataset->definition = definition_json;
+		return dataset;
+	}
+
+private:
+	enum class FrameType : uint8_t { ROOT, MEMBER_LIST, MEMBER, ROLLUP_LIST, ROLLUP, JOIN_LIST, JOIN, STRING_LIST };
+	enum class MemberKind : uint8_t { MEASURE, DIMENSION, TIME_DIMENSION };
+
+	struct Frame {
+		explicit Frame(FrameType type, vector<std::string> *strings = nullptr) : type(type), strings(strings) {
+		}
+		FrameType type;
+		//! Target of a STRING_LIST frame
+		vector<std::string> *strings;
+	};
+
+	Frame &Top() {
+		if (frames.empty()) {
+			Error("expected a JSON object");
+		}
+		return frames.back();
+	}
+
+	bool StartMemberList(MemberKind kind) {
+		member_kind = kind;
+		frames.push_back(Frame(FrameType::MEMBER_LIST));
+		return true;
+	}
+
+	bool IsKnownKey() const {
+		switch (frames.back().type) {
+		case FrameType::ROOT:
+			return KeyIsOneOf({"name", "measures", "dimensions", "time_dimensions", "rollups", "joins", "refresh_key",
+			                   "result_cache_ttl", "fiscal_year_start_month", "calendar_table"});
+		case FrameType::MEMBER:
+			return KeyIsOneOf({"name", "sql", "type"}) ||
+			       (member_kind == MemberKind::MEASURE && current_key == "percentile");
+		case FrameType::ROLLUP:
+			return KeyIsOneOf({"name", "measures", "dimensions", "time_dimension", "granularity"});
+		case FrameType::JOIN:
+			return KeyIsOneOf({"name", "table", "sql_on", "relationship", "refresh_key"});
+		default:
+			return false;
+		}
+	}
+
+	bool IsPercentile() {
+		return Top().type == FrameType::MEMBER && member_kind == MemberKind::MEASURE && current_key == "percentile";
+	}
+
+	bool SetFiscalYearStartMonth(number_unsigned_t val) {
+		if (val < 1 || val > 12) {
+			Error("\"fiscal_year_start_month\" must be between 1 and 12");
+		}
+		fiscal_year_start_month = NumericCast<idx_t>(val);
+		return true;
+	}
+
+	bool SetPercentile(double val) {
+		if (val < 0 || val > 1) {
+			Error("\"percentile\" must be between 0 and 1");
+		}
+		member_percentile = val;
+		return true;
+	}
+
+	bool IgnoreScalar(const char *value_type) {
+		auto type = Top().type;
+		if (type == FrameType::MEMBER_LIST || type == FrameType::ROLLUP_LIST || type == FrameType::JOIN_LIST ||
+		    type == FrameType::STRING_LIST || IsKnownKey()) {
+			return UnexpectedValue(value_type);
+		}
+		return true;
+	}
+
+	void AddMember() {
+		const char *kind_name = member_kind == MemberKind::MEASURE ? "measure" : "dimension";
+		if (member_name.empty()) {
+			Error(StringUtil::Format("%s is missing \"name\"", kind_name));
+		}
+		if (member_sql.empty()) {
+			Error(StringUtil::Format("%s '%s' is missing \"sql\"", kind_name, member_name));
+		}
+		if (member_kind == MemberKind::MEASURE) {
+			SemanticMeasure measure;
+			measure.name = std::move(member_name);
+			measure.aggregation_type = member_type.empty() ? "sum" : std::move(member_type);
+			measure.sql_expression = std::move(member_sql);
+			measure.percentile = member_percentile;
+			measure.expression = CompileMeasureExpression(measure);
+			measures.push_back(std::move(measure));
+			return;
+		}
+		SemanticDimension dimension;
+		dimension.name = std::move(member_name);
+		dimension.sql_expression = std::move(member_sql);
+		dimension.expression = ParseSemanticExpression(dimension.sql_expression);
+		if (!member_type.empty()) {
+			dimension.data_type = TransformStringToLogicalType(member_type);
+			if (dimension.data_type.id() == LogicalTypeId::USER) {
+				Error(StringUtil::Format("dimension '%s' has unknown type '%s'", dimension.name, member_type));
+			}
+		}
+		if (member_kind == MemberKind::TIME_DIMENSION) {
+			time_dimensions.push_back(std::move(dimension));
+		} else {
+			dimensions.push_back(std::move(dimension));
+		}
+	}
+
+	void AddJoin() {
+		auto &join = joins.back();
+		if (join.name.empty()) {
+			Error("join is missing \"name\"");
+		}
+		if (join.sql_on.empty()) {
+			Error(StringUtil::Format("join '%s' is missing \"sql_on\"", join.name));
+		}
+		if (join.table.empty()) {
+			join.table = join.name;
+		}
+		join.condition = ParseSemanticExpression(join.sql_on);
+		if (!join.refresh_key.empty()) {
+			// Only checked here, fingerprints use the SQL text
+			ParseSemanticExpression(join.refresh_key);
+		}
+	}
+
+private:
+	vector<Frame> frames;
+	bool done = false;
+	MemberKind member_kind = MemberKind::MEASURE;
+	std::string name;
+	std::string refresh_key;
+	optional_idx result_cache_ttl;
+	idx_t fiscal_year_start_month = 1;
+	std::string calendar_table;
+	//! Fields of the member object currently being parsed
+	std::string member_name;
+	std::string member_sql;
+	std::string member_type;
+	double member_percentile = SemanticMeasure::DEFAULT_PERCENTILE;
+
+	vector<SemanticMeasure> measures;
+	vector<SemanticDimension> dimensions;
+	vector<SemanticDimension> time_dimensions;
+	vector<SemanticRollup> rollups;
+	vector<SemanticJoin> joins;
+};
+
+shared_ptr<SemanticDataset> ParseSemanticDataset(const string &name, const string &definition_json) {
+	SemanticDatasetHandler handler;
+	json::sax_parse(definition_json, &handler);
+	return handler.Finalize(name, definition_json);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
@@ -0,0 +1,360 @@
+#include "quack_extension.hpp"
+#include "semantic_query_stats.hpp"
+#include "semantic_result_cache.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/profiler.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/date.hpp"
+#include "duckdb/common/vector_operations/vector_operations.hpp"
+#include "duckdb/main/appender.hpp"
+#include "duckdb/main/connection.hpp"
+#include "duckdb/parallel/task_executor.hpp"
+#include "duckdb/parser/keyword_helper.hpp"
+#include "duckdb/parser/query_node/select_node.hpp"
+#include "duckdb/parser/tableref.hpp"
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+//===--------------------------------------------------------------------===//
+// Partitioned execution
+//===--------------------------------------------------------------------===//
+// SEMANTIC_QUERY(json, partition_by := 'month') splits the date_range of the query's first time dimension that has
+// one into the months (days, quarters, years) it covers and runs the query over each of them as its own query, side
+// by side on the TaskScheduler. Each partition aggregates into a hash table of its own, and goes through the result
+// cache on its own - its cached result only depends on the rows of its partition, so a query over the last 13 months
+// only recomputes the partitions whose rows changed. When the groups of the query can span partitions (its
+// granularity is coarser than the partitions), the partial aggregates are merged, which needs re-aggregatable
+// measures. Partitions run on connections of their own and see committed data only.
+static constexpr idx_t MAX_PARTITIONS = 10000;
+
+static bool IsPartitionGranularity(const string &granularity) {
+	return granularity == "day" || granularity == "month" || granularity == "quarter" || granularity == "year";
+}
+
+static date_t ParseRangeDate(const string &value, const string &member) {
+	Value date;
+	if (!Value(value).DefaultTryCastAs(LogicalType::DATE, date) || !Date::IsFinite(date.GetValue<date_t>())) {
+		throw InvalidInputException("Value '%s' for '%s' is not a valid DATE", value, member);
+	}
+	return date.GetValue<date_t>();
+}
+
+// First day of the partition that holds the date
+static date_t PartitionStart(date_t date, const string &granularity) {
+	if (granularity == "day") {
+		return date;
+	}
+	int32_t year, month, day;
+	Date::Convert(date, year, month, day);
+	if (granularity == "quarter") {
+		month = (month - 1) / 3 * 3 + 1;
+	} else if (granularity == "year") {
+		month = 1;
+	}
+	return Date::FromDate(year, month, 1);
+}
+
+static date_t NextPartitionStart(date_t start, const string &granularity) {
+	if (granularity == "day") {
+		return date_t(start.days + 1);
+	}
+	int32_t year, month, day;
+	Date::Convert(start, year, month, day);
+	month += granularity == "month" ? 1 : granularity == "quarter" ? 3 : 12;
+	year += (month - 1) / 12;
+	month = (month - 1) % 12 + 1;
+	return Date::FromDate(year, month, 1);
+}
+
+// The aggregate that combines partial values of the measure, if there is one
+static string MergeFunction(const SemanticMeasure &measure) {
+	if (!IsCombinableMeasure(measure)) {
+		return string();
+	}
+	auto type = StringUtil::Lower(measure.aggregation_type);
+	if (type == "sum" || type == "count") {
+		// Partial counts add up
+		return "sum";
+	}
+	if (type == "min" || type == "max") {
+		return type;
+	}
+	return string();
+}
+
+static SemanticPartitionedQuery CompilePartitions(ClientContext &context, const string &query_json,
+                                                  const string &partition_granularity, string &dataset_name,
+                                                  SemanticQueryTimings &timings, bool &plan_cache_hit) {
+	if (!IsPartitionGranularity(partition_granularity)) {
+		throw InvalidInputException("partition_by must be day, month, quarter or year, not '%s'",
+		                            partition_granularity);
+	}
+	SemanticQuery query;
+	{
+		SemanticPhaseTimer timer(timings, SemanticQueryPhase::PARSE);
+		query = ParseSemanticQuery(query_json);
+		dataset_name = query.dataset;
+	}
+	auto &registry = DatasetRegistry::Get(context);
+	BoundSemanticQuery bound;
+	{
+		SemanticPhaseTimer timer(timings, SemanticQueryPhase::VALIDATE);
+		string error_msg;
+		if (!registry.ValidateQuery(query, bound, error_msg)) {
+			throw InvalidInputException("Semantic query validation failed: " + error_msg);
+		}
+		bound.in_list_threshold = registry.GetInListThreshold();
+	}
+	SemanticPhaseTimer timer(timings, SemanticQueryPhase::COMPILE);
+	auto &dataset = *bound.dataset;
+
+	optional_idx partitioned_idx;
+	for (idx_t i = 0; i < query.time_dimensions.size() && !partitioned_idx.IsValid(); i++) {
+		if (query.time_dimensions[i].date_range.size() == 2) {
+			partitioned_idx = i;
+		}
+	}
+	if (!partitioned_idx.IsValid()) {
+		throw InvalidInputException("Partitioned semantic queries need a time dimension with a date_range");
+	}
+	auto &time_dim = query.time_dimensions[partitioned_idx.GetIndex()];
+
+	SemanticPartitionedQuery result;
+	result.dataset = bound.dataset;
+	result.order = query.order;
+	result.limit = query.limit;
+	// Raw rows and groups within one partition are only concatenated
+	result.merge = !bound.measures.empty() && !time_dim.granularity.empty() &&
+	               !GranularityRollsUp(time_dim.granularity, partition_granularity);
+	for (auto measure_idx : bound.measures) {
+		auto &measure = dataset.measures[measure_idx];
+		auto merge_function = MergeFunction(measure);
+		if (result.merge && merge_function.empty()) {
+			throw InvalidInputException("Measure '%s' cannot be merged across '%s' partitions of '%s' - only sum, "
+			                            "count, min and max measures can",
+			                            measure.name, partition_granularity, time_dim.dimension);
+		}
+		result.merge_functions.push_back(std::move(merge_function));
+	}
+	result.merge_functions.resize(result.merge_functions.size() + bound.dimensions.size() +
+	                              bound.time_dimensions.size());
+
+	vector<pair<date_t, date_t>> ranges;
+	auto range_start = ParseRangeDate(time_dim.date_range[0], time_dim.dimension);
+	auto range_end = ParseRangeDate(time_dim.date_range[1], time_dim.dimension);
+	for (auto start = PartitionStart(range_start, partition_granularity); start <= range_end;
+	     start = NextPartitionStart(start, partition_granularity)) {
+		if (ranges.size() == MAX_PARTITIONS) {
+			throw InvalidInputException("The date_range of '%s' spans more than %d '%s' partitions", time_dim.dimension,
+			                            MAX_PARTITIONS, partition_granularity);
+		}
+		auto end = date_t(NextPartitionStart(start, partition_granularity).days - 1);
+		ranges.emplace_back(MaxValue(start, range_start), MinValue(end, range_end));
+	}
+	if (ranges.empty()) {
+		// An empty range still needs a query for the result columns
+		ranges.emplace_back(range_start, range_end);
+	}
+
+	// ORDER BY and LIMIT apply to the merged result. Without a merge, every row of the top N is among the top N of its
+	// partition, so the partitions keep them too and each returns at most N rows.
+	if (result.merge || query.limit <= 0) {
+		query.order.clear();
+		query.limit = -1;
+	}
+	{
+		// Bound, not run, over the dataset's table
+		auto con = MakeSemanticSideConnection(context);
+		auto prepared = con->Prepare(CompileSemanticQueryToSQL(query, bound));
+		if (prepared->HasError()) {
+			throw InvalidInputException("Semantic query failed to bind: %s", prepared->GetError());
+		}
+		result.names = prepared->GetNames();
+		result.types = prepared->GetTypes();
+	}
+	// The query is a plan cache hit when every one of its partitions is
+	plan_cache_hit = true;
+	for (auto &range : ranges) {
+		auto partition_query = query;
+		partition_query.time_dimensions[partitioned_idx.GetIndex()].date_range = {Date::ToString(range.first),
+		                                                                          Date::ToString(range.second)};
+		auto partition_bound = bound;
+		// The base rows of the partition, whether or not it ends up being served from a rollup
+		auto source = CompileSemanticQuery(partition_query, partition_bound);
+		auto partition_source = source->from_table->ToString();
+		if (source->where_clause) {
+			partition_source += " WHERE " + source->where_clause->ToString();
+		}
+		result.partition_sources.push_back(std::move(partition_source));
+		bool partition_cache_hit = false;
+		auto plan = CompileCachedSemanticQuery(registry, partition_query, partition_bound, partition_cache_hit);
+		plan_cache_hit = plan_cache_hit && partition_cache_hit;
+		result.partitions.push_back(plan->ToString());
+	}
+	return result;
+}
+
+SemanticPartitionedQuery CompilePartitionedSemanticQuery(ClientContext &context, const string &query_json,
+                                                         const string &partition_granularity) {
+	string dataset_name;
+	SemanticQueryTimings timings;
+	bool plan_cache_hit = false;
+	auto &query_stats = DatasetRegistry::Get(context).GetQueryStats();
+	Profiler profiler;
+	profiler.Start();
+	try {
+		auto result =
+		    CompilePartitions(context, query_json, partition_granularity, dataset_name, timings, plan_cache_hit);
+		profiler.End();
+		timings.total = profiler.Elapsed();
+		query_stats.Record(dataset_name, timings, plan_cache_hit, false);
+		return result;
+	} catch (...) {
+		profiler.End();
+		timings.total = profiler.Elapsed();
+		query_stats.Record(dataset_name, timings, false, true);
+		throw;
+	}
+}
+
+class SemanticPartitionTask : public BaseExecutorTask {
+public:
+	SemanticPartitionTask(TaskExecutor &executor, ClientContext &context, const SemanticPartitionedQuery &query,
+	                      idx_t partition_idx, bool use_cache, shared_ptr<const SemanticCachedResult> &result)
+	    : BaseExecutorTask(executor), context(context), query(query), partition_idx(partition_idx),
+	      use_cache(use_cache), result(result) {
+	}
+
+	void ExecuteTask() override {
+		auto &sql = query.partitions[partition_idx];
+		if (use_cache) {
+			result = ExecuteCachedSemanticQuery(context, *query.dataset, sql, query.partition_sources[partition_idx]);
+			return;
+		}
+		auto con = MakeSemanticSideConnection(context);
+		auto query_result = con->Query(sql);
+		if (query_result->HasError()) {
+			query_result->ThrowError();
+		}
+		auto partition_result = make_shared_ptr<SemanticCachedResult>();
+		partition_result->names = query_result->names;
+		partition_result->types = query_result->types;
+		partition_result->collection = query_result->TakeCollection();
+		result = std::move(partition_result);
+	}
+
+private:
+	ClientContext &context;
+	const SemanticPartitionedQuery &query;
+	idx_t partition_idx;
+	bool use_cache;
+	shared_ptr<const SemanticCachedResult> &result;
+};
+
+// The query over the concatenated partition results that returns the result of the whole query
+static string CompileMergeSQL(const SemanticPartitionedQuery &query) {
+	vector<string> select_list;
+	vector<string> groups;
+	for (idx_t col = 0; col < query.names.size(); col++) {
+		auto column = KeywordHelper::WriteOptionallyQuoted(query.names[col]);
+		auto &merge_function = query.merge_functions[col];
+		if (!query.merge) {
+			select_list.push_back(column);
+		} else if (merge_function.empty()) {
+			select_list.push_back(column);
+			groups.push_back(column);
+		} else {
+			// Merged measures keep the type of the unpartitioned query, e.g. BIGINT counts
+			select_list.push_back(StringUtil::Format("CAST(%s(%s) AS %s) AS %s", merge_function, column,
+			                                         query.types[col].ToString(), column));
+		}
+	}
+	auto sql = StringUtil::Format("SELECT %s FROM %s", StringUtil::Join(select_list, ", "),
+	                              SemanticPartitionedQuery::RESULTS_TABLE);
+	if (!groups.empty()) {
+		sql += " GROUP BY " + StringUtil::Join(groups, ", ");
+	}
+	vector<string> orders;
+	for (auto &order : query.order) {
+		orders.push_back(KeywordHelper::WriteOptionallyQuoted(order.id) + (order.desc ? " DESC" : ""));
+	}
+	if (!orders.empty()) {
+		sql += " ORDER BY " + StringUtil::Join(orders, ", ");
+	}
+	if (query.limit > 0) {
+		sql += " LIMIT " + to_string(query.limit);
+	}
+	return sql;
+}
+
+// The partition results are appended to a temporary table of a side connection (in time order, which a query
+// without ORDER BY keeps), and merged by a query over it
+static shared_ptr<const SemanticCachedResult>
+MergePartitions(ClientContext &context, const SemanticPartitionedQuery &query,
+                const vector<shared_ptr<const SemanticCachedResult>> &partitions) {
+	vector<string> columns;
+	for (idx_t col = 0; col < query.names.size(); col++) {
+		columns.push_back(KeywordHelper::WriteOptionallyQuoted(query.names[col]) + " " + query.types[col].ToString());
+	}
+	auto con_ptr = MakeSemanticSideConnection(context);
+	auto &con = *con_ptr;
+	auto created = con.Query(StringUtil::Format("CREATE TEMPORARY TABLE %s (%s)",
+	                                            SemanticPartitionedQuery::RESULTS_TABLE,
+	                                            StringUtil::Join(columns, ", ")));
+	if (created->HasError()) {
+		created->ThrowError();
+	}
+	{
+		Appender appender(con, SemanticPartitionedQuery::RESULTS_TABLE);
+		DataChunk cast_chunk;
+		cast_chunk.Initialize(context, query.types);
+		for (auto &partition : partitions) {
+			if (partition->types.size() != query.types.size()) {
+				throw InvalidInputException("A partition of the semantic query returned %d columns instead of %d",
+				                            partition->types.size(), query.types.size());
+			}
+			for (auto &chunk : partition->collection->Chunks()) {
+				if (partition->types == query.types) {
+					appender.AppendDataChunk(chunk);
+					continue;
+				}
+				cast_chunk.Reset();
+				for (idx_t col = 0; col < chunk.ColumnCount(); col++) {
+					VectorOperations::Cast(context, chunk.data[col], cast_chunk.data[col], chunk.size());
+				}
+				cast_chunk.SetCardinality(chunk.size());
+				appender.AppendDataChunk(cast_chunk);
+			}
+		}
+		appender.Close();
+	}
+	auto merged = con.Query(CompileMergeSQL(query));
+	if (merged->HasError()) {
+		merged->ThrowError();
+	}
+	auto result = make_shared_ptr<SemanticCachedResult>();
+	result->names = merged->names;
+	result->types = merged->types;
+	result->collection = merged->TakeCollection();
+	return std::move(result);
+}
+
+shared_ptr<const SemanticCachedResult> ExecutePartitionedSemanticQuery(ClientContext &context,
+                                                                       const SemanticPartitionedQuery &query) {
+	D_ASSERT(!query.partitions.empty());
+	auto use_cache = DatasetRegistry::Get(context).GetResultCache().Enabled();
+	vector<shared_ptr<const SemanticCachedResult>> partitions(query.partitions.size());
+	TaskExecutor executor(context);
+	for (idx_t i = 0; i < query.partitions.size(); i++) {
+		executor.ScheduleTask(make_uniq<SemanticPartitionTask>(executor, context, query, i, use_cache, partitions[i]));
+	}
+	// The calling thread works on the partitions too
+	executor.WorkOnTasks();
+	return MergePartitions(context, query, partitions);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
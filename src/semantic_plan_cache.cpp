@@ -0,0 +1,230 @@
+#include "semantic_plan_cache.hpp"
+#include "quack_extension.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/common/types/hash.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/main/extension_util.hpp"
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+// Length-prefix every part so that concatenated values cannot collide
+static void AppendKeyPart(string &key, const string &part) {
+	key += to_string(part.size());
+	key += ':';
+	key += part;
+}
+
+static void AppendKeyList(string &key, const vector<string> &parts) {
+	AppendKeyPart(key, to_string(parts.size()));
+	for (const auto &part : parts) {
+		AppendKeyPart(key, part);
+	}
+}
+
+static void AppendKeyFilters(string &key, const vector<SemanticFilter> &filters) {
+	AppendKeyPart(key, to_string(filters.size()));
+	for (const auto &filter : filters) {
+		AppendKeyPart(key, filter.dimension);
+		AppendKeyPart(key, filter.operator_);
+		AppendKeyList(key, filter.values);
+		AppendKeyFilters(key, filter.filters);
+	}
+}
+
+string SemanticPlanCache::GetCacheKey(const SemanticQuery &query, idx_t in_list_threshold) {
+	string key;
+	AppendKeyPart(key, query.dataset);
+	AppendKeyList(key, query.measures);
+	AppendKeyList(key, query.dimensions);
+	AppendKeyFilters(key, query.filters);
+	AppendKeyPart(key, to_string(query.time_dimensions.size()));
+	for (const auto &time_dim : query.time_dimensions) {
+		AppendKeyPart(key, time_dim.dimension);
+		AppendKeyPart(key, time_dim.granularity);
+		AppendKeyList(key, time_dim.date_range);
+	}
+	AppendKeyPart(key, to_string(query.order.size()));
+	for (const auto &order : query.order) {
+		AppendKeyPart(key, order.id);
+		AppendKeyPart(key, order.desc ? "desc" : "asc");
+	}
+	AppendKeyPart(key, to_string(query.limit));
+	AppendKeyPart(key, query.time_zone);
+	AppendKeyPart(key, to_string(in_list_threshold));
+	return key;
+}
+
+hash_t SemanticPlanCache::GetTextHash(const string &query_text, idx_t in_list_threshold) {
+	return CombineHash(Hash(query_text.c_str(), query_text.size()), Hash(in_list_threshold));
+}
+
+unique_ptr<QueryNode> SemanticPlanCache::Lookup(const string &key, idx_t dataset_version) {
+	auto hash = Hash(key.c_str(), key.size());
+	lock_guard<mutex> guard(lock);
+	auto entry = index.find(hash);
+	if (entry == index.end() || entry->second->key != key) {
+		stats.misses++;
+		return nullptr;
+	}
+	if (entry->second->dataset_version != dataset_version) {
+		// Compiled against an older definition of the dataset
+		Erase(entry->second);
+		stats.invalidations++;
+		stats.misses++;
+		return nullptr;
+	}
+	stats.hits++;
+	// Move the entry to the front of the LRU list
+	entries.splice(entries.begin(), entries, entry->second);
+	return entry->second->plan->Copy();
+}
+
+bool SemanticPlanCache::LookupText(const string &query_text, idx_t in_list_threshold, string &key, string &dataset) {
+	auto text_hash = GetTextHash(query_text, in_list_threshold);
+	lock_guard<mutex> guard(lock);
+	auto entry = text_index.find(text_hash);
+	if (entry == text_index.end() || entry->second->in_list_threshold != in_list_threshold ||
+	    entry->second->text != query_text) {
+		return false;
+	}
+	key = entry->second->key;
+	dataset = entry->second->dataset;
+	return true;
+}
+
+void SemanticPlanCache::Insert(const string &key, const string &query_text, idx_t in_list_threshold,
+                               const string &dataset, idx_t dataset_version, unique_ptr<QueryNode> plan) {
+	auto hash = Hash(key.c_str(), key.size());
+	auto text_hash = GetTextHash(query_text, in_list_threshold);
+	lock_guard<mutex> guard(lock);
+	if (capacity == 0) {
+		return;
+	}
+	auto existing = index.find(hash);
+	if (existing != index.end()) {
+		// Either a concurrent insert of the same query or a hash collision - keep the newest plan
+		Erase(existing->second);
+	}
+	entries.push_front(
+	    CacheEntry {hash, key, text_hash, query_text, in_list_threshold, dataset, dataset_version, std::move(plan)});
+	index[hash] = entries.begin();
+	// Plans of queries that were not compiled from a JSON text (e.g. those of a batch) are only found by their key
+	if (!query_text.empty()) {
+		// On a text hash collision the older entry is only found by its key from now on
+		text_index[text_hash] = entries.begin();
+	}
+	EvictToCapacity();
+}
+
+void SemanticPlanCache::Erase(list<CacheEntry>::iterator entry) {
+	index.erase(entry->hash);
+	auto text_entry = text_index.find(entry->text_hash);
+	if (text_entry != text_index.end() && text_entry->second == entry) {
+		text_index.erase(text_entry);
+	}
+	entries.erase(entry);
+}
+
+void SemanticPlanCache::InvalidateDataset(const string &dataset) {
+	lock_guard<mutex> guard(lock);
+	for (auto it = entries.begin(); it != entries.end();) {
+		if (it->dataset == dataset) {
+			Erase(it++);
+			stats.invalidations++;
+		} else {
+			++it;
+		}
+	}
+}
+
+void SemanticPlanCache::InvalidateAll() {
+	lock_guard<mutex> guard(lock);
+	stats.invalidations += entries.size();
+	entries.clear();
+	index.clear();
+	text_index.clear();
+}
+
+void SemanticPlanCache::SetCapacity(idx_t capacity_p) {
+	lock_guard<mutex> guard(lock);
+	capacity = capacity_p;
+	EvictToCapacity();
+}
+
+void SemanticPlanCache::EvictToCapacity() {
+	while (entries.size() > capacity) {
+		Erase(std::prev(entries.end()));
+		stats.evictions++;
+	}
+}
+
+SemanticPlanCacheStats SemanticPlanCache::GetStats() {
+	lock_guard<mutex> guard(lock);
+	auto result = stats;
+	result.entries = entries.size();
+	result.capacity = capacity;
+	return result;
+}
+
+// semantic_plan_cache_size setting
+static void SetSemanticPlanCacheSize(ClientContext &context, SetScope scope, Value &parameter) {
+	auto size = parameter.GetValue<int64_t>();
+	if (size < 0) {
+		throw InvalidInputException("semantic_plan_cache_size must be non-negative");
+	}
+	DatasetRegistry::Get(context).GetPlanCache().SetCapacity(NumericCast<idx_t>(size));
+}
+
+// semantic_plan_cache_stats() table function
+struct SemanticPlanCacheStatsState : public GlobalTableFunctionState {
+	bool finished = false;
+};
+
+static unique_ptr<FunctionData> SemanticPlanCacheStatsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                           vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"hits", "misses", "evictions", "invalidations", "entries", "capacity"};
+	return_types = {LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT};
+	return make_uniq<TableFunctionData>();
+}
+
+static unique_ptr<GlobalTableFunctionState> SemanticPlanCacheStatsInit(ClientContext &context,
+                                                                       TableFunctionInitInput &input) {
+	return make_uniq<SemanticPlanCacheStatsState>();
+}
+
+static void SemanticPlanCacheStatsFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<SemanticPlanCacheStatsState>();
+	if (state.finished) {
+		output.SetCardinality(0);
+		return;
+	}
+	auto stats = DatasetRegistry::Get(context).GetPlanCache().GetStats();
+	output.SetCardinality(1);
+	output.SetValue(0, 0, Value::UBIGINT(stats.hits));
+	output.SetValue(1, 0, Value::UBIGINT(stats.misses));
+	output.SetValue(2, 0, Value::UBIGINT(stats.evictions));
+	output.SetValue(3, 0, Value::UBIGINT(stats.invalidations));
+	output.SetValue(4, 0, Value::UBIGINT(stats.entries));
+	output.SetValue(5, 0, Value::UBIGINT(stats.capacity));
+	state.finished = true;
+}
+
+void RegisterSemanticPlanCacheFunctions(DatabaseInstance &instance) {
+	auto &config = DBConfig::GetConfig(instance);
+	config.AddExtensionOption("semantic_plan_cache_size",
+	                          "Maximum number of compiled semantic queries kept in the plan cache (0 disables it)",
+	                          LogicalType::BIGINT, Value::BIGINT(SemanticPlanCache::DEFAULT_CAPACITY),
+	                          SetSemanticPlanCacheSize);
+
+	TableFunction stats_func("semantic_plan_cache_stats", {}, SemanticPlanCacheStatsFunction,
+	                         SemanticPlanCacheStatsBind, SemanticPlanCacheStatsInit);
+	ExtensionUtil::RegisterFunction(instance, stats_func);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
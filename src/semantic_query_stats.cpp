@@ -0,0 +1,101 @@
+#include "semantic_query_stats.hpp"
+#include "quack_extension.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/extension_util.hpp"
+
+#include <algorithm>
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+void SemanticQueryStats::Record(const string &dataset, const SemanticQueryTimings &timings, bool plan_cache_hit,
+                                bool failed) {
+	lock_guard<mutex> guard(lock);
+	auto &stats = datasets[dataset];
+	stats.queries++;
+	if (plan_cache_hit) {
+		stats.plan_cache_hits++;
+	}
+	if (failed) {
+		stats.errors++;
+	}
+	for (idx_t i = 0; i < SEMANTIC_QUERY_PHASE_COUNT; i++) {
+		stats.phase_time[i] += timings.phases[i];
+	}
+	stats.total_time += timings.total;
+	stats.max_time = MaxValue(stats.max_time, timings.total);
+}
+
+vector<pair<string, SemanticDatasetQueryStats>> SemanticQueryStats::GetStats() {
+	vector<pair<string, SemanticDatasetQueryStats>> result;
+	{
+		lock_guard<mutex> guard(lock);
+		result.insert(result.end(), datasets.begin(), datasets.end());
+	}
+	std::sort(result.begin(), result.end(),
+	          [](const pair<string, SemanticDatasetQueryStats> &a, const pair<string, SemanticDatasetQueryStats> &b) {
+		          return a.first < b.first;
+	          });
+	return result;
+}
+
+// semantic_query_stats() table function
+struct SemanticQueryStatsState : public GlobalTableFunctionState {
+	vector<pair<string, SemanticDatasetQueryStats>> stats;
+	idx_t offset = 0;
+};
+
+static unique_ptr<FunctionData> SemanticQueryStatsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                       vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"dataset",     "queries",    "plan_cache_hits", "errors", "parse_ms", "plan_cache_lookup_ms",
+	         "validate_ms", "compile_ms", "total_ms",        "max_ms"};
+	return_types = {LogicalType::VARCHAR, LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::DOUBLE,  LogicalType::DOUBLE,  LogicalType::DOUBLE,  LogicalType::DOUBLE,
+	                LogicalType::DOUBLE,  LogicalType::DOUBLE};
+	return make_uniq<TableFunctionData>();
+}
+
+static unique_ptr<GlobalTableFunctionState> SemanticQueryStatsInit(ClientContext &context,
+                                                                   TableFunctionInitInput &input) {
+	auto result = make_uniq<SemanticQueryStatsState>();
+	result->stats = DatasetRegistry::Get(context).GetQueryStats().GetStats();
+	return std::move(result);
+}
+
+static Value Milliseconds(double seconds) {
+	return Value::DOUBLE(seconds * 1000.0);
+}
+
+static void SemanticQueryStatsFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<SemanticQueryStatsState>();
+	idx_t count = 0;
+	while (state.offset < state.stats.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &entry = state.stats[state.offset++];
+		auto &stats = entry.second;
+		// Queries that failed before naming a dataset are reported with a NULL dataset
+		output.SetValue(0, count, entry.first.empty() ? Value(LogicalType::VARCHAR) : Value(entry.first));
+		output.SetValue(1, count, Value::UBIGINT(stats.queries));
+		output.SetValue(2, count, Value::UBIGINT(stats.plan_cache_hits));
+		output.SetValue(3, count, Value::UBIGINT(stats.errors));
+		output.SetValue(4, count, Milliseconds(stats.phase_time[static_cast<idx_t>(SemanticQueryPhase::PARSE)]));
+		output.SetValue(5, count,
+		                Milliseconds(stats.phase_time[static_cast<idx_t>(SemanticQueryPhase::PLAN_CACHE_LOOKUP)]));
+		output.SetValue(6, count, Milliseconds(stats.phase_time[static_cast<idx_t>(SemanticQueryPhase::VALIDATE)]));
+		output.SetValue(7, count, Milliseconds(stats.phase_time[static_cast<idx_t>(SemanticQueryPhase::COMPILE)]));
+		output.SetValue(8, count, Milliseconds(stats.total_time));
+		output.SetValue(9, count, Milliseconds(stats.max_time));
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+void RegisterSemanticQueryStatsFunctions(DatabaseInstance &instance) {
+	TableFunction stats_func("semantic_query_stats", {}, SemanticQueryStatsFunction, SemanticQueryStatsBind,
+	                         SemanticQueryStatsInit);
+	ExtensionUtil::RegisterFunction(instance, stats_func);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
@@ -0,0 +1,623 @@
+#include "quack_extension.hpp"
+#include "semantic_plan_cache.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/hash.hpp"
+#include "duckdb/common/unordered_set.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/main/connection.hpp"
+#include "duckdb/parser/expression/columnref_expression.hpp"
+#include "duckdb/parser/expression/comparison_expression.hpp"
+#include "duckdb/parser/expression/conjunction_expression.hpp"
+#include "duckdb/parser/parsed_expression_iterator.hpp"
+#include "duckdb/parser/tableref.hpp"
+
+#include <algorithm>
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+// Rollup tables live next to the persisted definitions, named so that they never need quoting. The length of the
+// dataset name separates it from the rollup name ("a_b" + "c" is not "a" + "b_c"). Names that are not all lower case
+// letters, digits and underscores lose characters to that, so their table names carry a hash of the actual names
+// instead, after an "h" that a length never starts with.
+static string GetRollupTableName(const string &dataset_name, const string &rollup_name) {
+	string escaped;
+	bool lossless = true;
+	for (auto c : dataset_name + "_" + rollup_name) {
+		auto lower = StringUtil::CharacterToLower(c);
+		lossless = lossless && lower == c && (StringUtil::CharacterIsAlphaNumeric(c) || c == '_');
+		escaped += StringUtil::CharacterIsAlphaNumeric(c) ? lower : '_';
+	}
+	string result = "__semantic_rollup_";
+	if (!lossless) {
+		auto names_hash = CombineHash(Hash(dataset_name.c_str(), dataset_name.size()),
+		                              Hash(rollup_name.c_str(), rollup_name.size()));
+		result += "h";
+		for (idx_t shift = 64; shift > 0; shift -= 4) {
+			result += "0123456789abcdef"[(names_hash >> (shift - 4)) & 0xF];
+		}
+		result += "_";
+	}
+	return result + to_string(dataset_name.size()) + "_" + escaped;
+}
+
+static void BindRollup(const SemanticDataset &dataset, SemanticRollup &rollup) {
+	if (rollup.measures.empty()) {
+		throw InvalidInputException("Rollup '%s' of dataset '%s' has no measures", rollup.name, dataset.name);
+	}
+	for (auto &measure_name : rollup.measures) {
+		auto measure_idx = dataset.FindMeasure(measure_name);
+		if (!measure_idx.IsValid()) {
+			throw InvalidInputException("Rollup '%s' of dataset '%s' references unknown measure '%s'", rollup.name,
+			                            dataset.name, measure_name);
+		}
+		rollup.measure_indexes.push_back(measure_idx.GetIndex());
+	}
+	for (auto &dimension_name : rollup.dimensions) {
+		auto dimension_idx = dataset.FindDimension(dimension_name);
+		if (!dimension_idx.IsValid()) {
+			throw InvalidInputException("Rollup '%s' of dataset '%s' references unknown dimension '%s'", rollup.name,
+			                            dataset.name, dimension_name);
+		}
+		rollup.dimension_indexes.push_back(dimension_idx.GetIndex());
+	}
+	if (!rollup.time_dimension.empty()) {
+		rollup.time_dimension_index = dataset.FindDimension(rollup.time_dimension);
+		if (!rollup.time_dimension_index.IsValid()) {
+			throw InvalidInputException("Rollup '%s' of dataset '%s' references unknown time dimension '%s'",
+			                            rollup.name, dataset.name, rollup.time_dimension);
+		}
+		// Fiscal periods depend on settings of the dataset, which partition keys of refreshes do not know about
+		if (!IsSupportedGranularity(rollup.granularity) || StringUtil::StartsWith(rollup.granularity, "fiscal_")) {
+			throw InvalidInputException(
+			    "Rollup '%s' of dataset '%s' needs an hour, day, week, month, quarter or year granularity", rollup.name,
+			    dataset.name);
+		}
+	}
+	rollup.table_name = GetRollupTableName(dataset.name, rollup.name);
+}
+
+static void CollectColumnReferences(const ParsedExpression &expr, vector<const ColumnRefExpression *> &columns) {
+	if (expr.GetExpressionClass() == ExpressionClass::COLUMN_REF) {
+		columns.push_back(&expr.Cast<ColumnRefExpression>());
+		return;
+	}
+	ParsedExpressionIterator::EnumerateChildren(
+	    expr, [&](const ParsedExpression &child) { CollectColumnReferences(child, columns); });
+}
+
+static void AddJoin(vector<idx_t> &joins, idx_t join_idx, const vector<SemanticJoin> &dataset_joins) {
+	joins.push_back(join_idx);
+	auto &dependencies = dataset_joins[join_idx].dependencies;
+	joins.insert(joins.end(), dependencies.begin(), dependencies.end());
+}
+
+// The joins an expression refers to through qualified column references, with the joins those depend on - sorted,
+// which is an order they can be joined in
+static vector<idx_t> ReferencedJoins(const SemanticDataset &dataset, const ParsedExpression &expr) {
+	vector<const ColumnRefExpression *> columns;
+	CollectColumnReferences(expr, columns);
+	vector<idx_t> joins;
+	for (auto column : columns) {
+		if (!column->IsQualified()) {
+			continue;
+		}
+		auto join_idx = dataset.FindJoin(column->GetTableName());
+		if (join_idx.IsValid()) {
+			AddJoin(joins, join_idx.GetIndex(), dataset.joins);
+		}
+	}
+	std::sort(joins.begin(), joins.end());
+	joins.erase(std::unique(joins.begin(), joins.end()), joins.end());
+	return joins;
+}
+
+static bool OnlyReferences(const ParsedExpression &expr, const string &join_name) {
+	vector<const ColumnRefExpression *> columns;
+	CollectColumnReferences(expr, columns);
+	for (auto column : columns) {
+		if (!column->IsQualified() || column->GetTableName() != join_name) {
+			return false;
+		}
+	}
+	return !columns.empty();
+}
+
+static bool References(const ParsedExpression &expr, const string &join_name) {
+	vector<const ColumnRefExpression *> columns;
+	CollectColumnReferences(expr, columns);
+	for (auto column : columns) {
+		if (column->IsQualified() && column->GetTableName() == join_name) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// A one_to_many join is aggregated by its key before it is joined, so its condition has to be equalities between
+// the columns of the table and expressions over the rest of the dataset
+static void BindOneToManyKeys(const SemanticDataset &dataset, SemanticJoin &join) {
+	vector<const ParsedExpression *> equalities;
+	if (join.condition->GetExpressionType() == ExpressionType::CONJUNCTION_AND) {
+		for (auto &child : join.condition->Cast<ConjunctionExpression>().children) {
+			equalities.push_back(child.get());
+		}
+	} else {
+		equalities.push_back(join.condition.get());
+	}
+	for (auto equality : equalities) {
+		if (equality->GetExpressionType() == ExpressionType::COMPARE_EQUAL) {
+			auto &comparison = equality->Cast<ComparisonExpression>();
+			if (OnlyReferences(*comparison.right, join.name) && !References(*comparison.left, join.name)) {
+				join.dataset_keys.push_back(comparison.left->Copy());
+				join.table_keys.push_back(comparison.right->Copy());
+				continue;
+			}
+			if (OnlyReferences(*comparison.left, join.name) && !References(*comparison.right, join.name)) {
+				join.dataset_keys.push_back(comparison.right->Copy());
+				join.table_keys.push_back(comparison.left->Copy());
+				continue;
+			}
+		}
+		throw InvalidInputException("one_to_many join '%s' of dataset '%s' needs a \"sql_on\" of equalities "
+		                            "between its columns and those of the dataset",
+		                            join.name, dataset.name);
+	}
+}
+
+static void BindJoin(const SemanticDataset &dataset, idx_t join_idx, SemanticJoin &join) {
+	if (join.relationship.empty()) {
+		join.relationship = "many_to_one";
+	}
+	if (join.relationship != "many_to_one" && join.relationship != "one_to_one" && !join.IsOneToMany()) {
+		throw InvalidInputException("Join '%s' of dataset '%s' has unsupported relationship '%s' - expected "
+		                            "many_to_one, one_to_one or one_to_many",
+		                            join.name, dataset.name, join.relationship);
+	}
+	vector<const ColumnRefExpression *> columns;
+	CollectColumnReferences(*join.condition, columns);
+	for (auto column : columns) {
+		if (!column->IsQualified()) {
+			continue;
+		}
+		auto dependency_idx = dataset.FindJoin(column->GetTableName());
+		if (!dependency_idx.IsValid() || dependency_idx.GetIndex() == join_idx) {
+			continue;
+		}
+		auto &dependency = dataset.joins[dependency_idx.GetIndex()];
+		if (dependency_idx.GetIndex() > join_idx) {
+			throw InvalidInputException("Join '%s' of dataset '%s' refers to join '%s', which has to be declared "
+			                            "before it",
+			                            join.name, dataset.name, dependency.name);
+		}
+		if (dependency.IsOneToMany()) {
+			throw InvalidInputException("Join '%s' of dataset '%s' cannot be joined through the one_to_many join '%s'",
+			                            join.name, dataset.name, dependency.name);
+		}
+		AddJoin(join.dependencies, dependency_idx.GetIndex(), dataset.joins);
+	}
+	std::sort(join.dependencies.begin(), join.dependencies.end());
+	join.dependencies.erase(std::unique(join.dependencies.begin(), join.dependencies.end()), join.dependencies.end());
+	if (join.IsOneToMany()) {
+		BindOneToManyKeys(dataset, join);
+	}
+}
+
+static const SemanticJoin *FindOneToManyJoin(const SemanticDataset &dataset, const vector<idx_t> &joins) {
+	for (auto join_idx : joins) {
+		if (dataset.joins[join_idx].IsOneToMany()) {
+			return &dataset.joins[join_idx];
+		}
+	}
+	return nullptr;
+}
+
+// Measures over a one_to_many join are computed per join key and aggregated again over the dataset's rows, which
+// only works for aggregates whose partial results combine - and only when the measure reads just that table
+static void BindOneToManyMeasure(const SemanticDataset &dataset, const SemanticMeasure &measure,
+                                 const SemanticJoin &join) {
+	auto sql = ParseSemanticExpression(measure.sql_expression);
+	// A complete aggregate expression is kept as is, so it cannot be split into partial aggregates
+	bool complete_aggregate = measure.expression->Equals(*sql);
+	if (!IsCombinableMeasure(measure) || complete_aggregate || !OnlyReferences(*sql, join.name)) {
+		throw InvalidInputException("Measure '%s' of dataset '%s' over the one_to_many join '%s' has to be a sum, "
+		                            "count, min or max of columns of the join",
+		                            measure.name, dataset.name, join.name);
+	}
+}
+
+static void BindJoins(SemanticDataset &dataset) {
+	for (idx_t i = 0; i < dataset.joins.size(); i++) {
+		BindJoin(dataset, i, dataset.joins[i]);
+	}
+	for (auto &measure : dataset.measures) {
+		measure.joins = ReferencedJoins(dataset, *measure.expression);
+		auto join = FindOneToManyJoin(dataset, measure.joins);
+		if (join) {
+			BindOneToManyMeasure(dataset, measure, *join);
+		}
+	}
+	for (auto &dimension : dataset.dimensions) {
+		dimension.joins = ReferencedJoins(dataset, *dimension.expression);
+		auto join = FindOneToManyJoin(dataset, dimension.joins);
+		if (join) {
+			throw InvalidInputException("Dimension '%s' of dataset '%s' refers to the one_to_many join '%s' - only "
+			                            "measures can",
+			                            dimension.name, dataset.name, join->name);
+		}
+	}
+}
+
+SemanticDataset::SemanticDataset(string name_p, vector<SemanticMeasure> measures_p,
+                                 vector<SemanticDimension> dimensions_p, vector<SemanticRollup> rollups_p,
+                                 vector<SemanticJoin> joins_p)
+    : name(std::move(name_p)), measures(std::move(measures_p)), dimensions(std::move(dimensions_p)),
+      rollups(std::move(rollups_p)), joins(std::move(joins_p)) {
+	measure_index.reserve(measures.size());
+	for (idx_t i = 0; i < measures.size(); i++) {
+		if (!measure_index.emplace(measures[i].name, i).second) {
+			throw InvalidInputException("Measure '%s' is defined more than once in dataset '%s'", measures[i].name,
+			                            name);
+		}
+	}
+	dimension_index.reserve(dimensions.size());
+	for (idx_t i = 0; i < dimensions.size(); i++) {
+		if (!dimension_index.emplace(dimensions[i].name, i).second) {
+			throw InvalidInputException("Dimension '%s' is defined more than once in dataset '%s'",
+			                            dimensions[i].name, name);
+		}
+	}
+	join_index.reserve(joins.size());
+	for (idx_t i = 0; i < joins.size(); i++) {
+		if (!join_index.emplace(joins[i].name, i).second) {
+			throw InvalidInputException("Join '%s' is defined more than once in dataset '%s'", joins[i].name, name);
+		}
+	}
+	BindJoins(*this);
+	unordered_set<string> rollup_names;
+	for (auto &rollup : rollups) {
+		if (!rollup_names.insert(rollup.name).second) {
+			throw InvalidInputException("Rollup '%s' is defined more than once in dataset '%s'", rollup.name, name);
+		}
+		BindRollup(*this, rollup);
+	}
+}
+
+optional_idx SemanticDataset::FindMeasure(const string &member_name) const {
+	auto entry = measure_index.find(member_name);
+	return entry != measure_index.end() ? optional_idx(entry->second) : optional_idx();
+}
+
+optional_idx SemanticDataset::FindDimension(const string &member_name) const {
+	auto entry = dimension_index.find(member_name);
+	return entry != dimension_index.end() ? optional_idx(entry->second) : optional_idx();
+}
+
+optional_idx SemanticDataset::FindJoin(const string &join_name) const {
+	auto entry = join_index.find(join_name);
+	return entry != join_index.end() ? optional_idx(entry->second) : optional_idx();
+}
+
+// Dataset Registry Implementation
+constexpr const char *DatasetRegistry::OBJECT_TYPE;
+constexpr const char *DatasetRegistry::PERSISTENCE_TABLE;
+constexpr const char *DatasetRegistry::ROLLUP_STATE_TABLE;
+constexpr const char *DatasetRegistry::ROLLUP_PARTITIONS_TABLE;
+constexpr idx_t DatasetRegistry::DEFAULT_IN_LIST_THRESHOLD;
+
+DatasetRegistry::DatasetRegistry() : snapshot_(std::make_shared<const DatasetMap>()) {
+}
+
+DatasetRegistry &DatasetRegistry::Get(DatabaseInstance &db) {
+	// The object cache keeps the registry alive for the lifetime of the database instance
+	return *db.GetObjectCache().GetOrCreate<DatasetRegistry>(OBJECT_TYPE);
+}
+
+DatasetRegistry &DatasetRegistry::Get(ClientContext &context) {
+	return Get(*context.db);
+}
+
+// The types the dimension expressions have over the source table, from binding them against the catalog - or an
+// empty vector if they do not bind
+static vector<LogicalType> BindDimensionTypes(Connection &con, const string &source, const vector<string> &columns) {
+	auto prepared = con.Prepare(StringUtil::Format("SELECT %s FROM %s", StringUtil::Join(columns, ", "), source));
+	if (prepared->HasError()) {
+		return vector<LogicalType>();
+	}
+	return prepared->GetTypes();
+}
+
+// Dimensions without an explicit "type" take the type of their expression. Dimensions of a source that does not
+// exist (yet), or whose expression does not bind, keep an unknown type - their filter values stay strings.
+static void InferDimensionTypes(Connection &con, SemanticDataset &dataset) {
+	vector<idx_t> untyped;
+	vector<string> columns;
+	for (idx_t i = 0; i < dataset.dimensions.size(); i++) {
+		if (dataset.dimensions[i].data_type.id() == LogicalTypeId::INVALID) {
+			untyped.push_back(i);
+			columns.push_back(dataset.dimensions[i].sql_expression);
+		}
+	}
+	if (untyped.empty()) {
+		return;
+	}
+	// The source with every join that dimensions can refer to
+	vector<idx_t> joins;
+	for (idx_t i = 0; i < dataset.joins.size(); i++) {
+		if (!dataset.joins[i].IsOneToMany()) {
+			joins.push_back(i);
+		}
+	}
+	auto source = CompileDatasetSource(dataset, joins, vector<idx_t>())->ToString();
+	auto types = BindDimensionTypes(con, source, columns);
+	if (types.size() == untyped.size()) {
+		for (idx_t i = 0; i < untyped.size(); i++) {
+			dataset.dimensions[untyped[i]].data_type = types[i];
+		}
+		return;
+	}
+	// One of the expressions did not bind - type the others one by one
+	for (idx_t i = 0; i < untyped.size(); i++) {
+		auto column_types = BindDimensionTypes(con, source, {columns[i]});
+		if (column_types.size() == 1) {
+			dataset.dimensions[untyped[i]].data_type = column_types[0];
+		}
+	}
+}
+
+void DatasetRegistry::RegisterDataset(DatabaseInstance &db, shared_ptr<SemanticDataset> dataset) {
+	vector<shared_ptr<SemanticDataset>> datasets;
+	datasets.push_back(std::move(dataset));
+	RegisterDatasets(db, std::move(datasets));
+}
+
+void DatasetRegistry::RegisterDatasets(DatabaseInstance &db, vector<shared_ptr<SemanticDataset>> datasets) {
+	{
+		// Runs on a separate connection, like PersistDatasets, so only committed tables are seen
+		Connection con(db);
+		for (auto &dataset : datasets) {
+			InferDimensionTypes(con, *dataset);
+		}
+	}
+	vector<string> published;
+	{
+		// Holding the write lock while persisting keeps the stored definitions in registration order
+		lock_guard<mutex> guard(write_lock_);
+		PersistDatasets(db, datasets);
+		published = PublishDatasets(std::move(datasets));
+	}
+	WarmupDatasets(published);
+}
+
+vector<string> DatasetRegistry::PublishDatasets(vector<shared_ptr<SemanticDataset>> datasets) {
+	auto new_snapshot = std::make_shared<DatasetMap>(*GetSnapshot());
+	vector<string> names;
+	names.reserve(datasets.size());
+	for (auto &dataset : datasets) {
+		names.push_back(dataset->name);
+		dataset->version = ++last_version_;
+		(*new_snapshot)[dataset->name] = shared_ptr<const SemanticDataset>(std::move(dataset));
+	}
+	std::atomic_store(&snapshot_, std::shared_ptr<const DatasetMap>(std::move(new_snapshot)));
+	// Compiled plans and results for the previous definitions are no longer valid
+	for (auto &name : names) {
+		plan_cache_.InvalidateDataset(name);
+		result_cache_.InvalidateDataset(name);
+	}
+	return names;
+}
+
+// Definitions are stored through a separate connection: registration runs inside a query of the calling connection,
+// which cannot run another statement itself
+void DatasetRegistry::PersistDatasets(DatabaseInstance &db, const vector<shared_ptr<SemanticDataset>> &datasets) {
+	if (datasets.empty() || DBConfig::GetConfig(db).options.access_mode == AccessMode::READ_ONLY) {
+		return;
+	}
+	Connection con(db);
+	auto result = con.Query(StringUtil::Format(
+	    "CREATE TABLE IF NOT EXISTS %s (name VARCHAR PRIMARY KEY, definition VARCHAR NOT NULL)", PERSISTENCE_TABLE));
+	if (result->HasError()) {
+		throw InvalidInputException("Failed to persist datasets: %s", result->GetError());
+	}
+	con.BeginTransaction();
+	auto insert = con.Prepare(StringUtil::Format("INSERT OR REPLACE INTO %s VALUES ($1, $2)", PERSISTENCE_TABLE));
+	if (insert->HasError()) {
+		con.Rollback();
+		throw InvalidInputException("Failed to persist datasets: %s", insert->GetError());
+	}
+	for (auto &dataset : datasets) {
+		auto insert_result = insert->Execute(Value(dataset->name), Value(dataset->definition));
+		if (insert_result->HasError()) {
+			con.Rollback();
+			throw InvalidInputException("Failed to persist dataset '%s': %s", dataset->name,
+			                            insert_result->GetError());
+		}
+	}
+	con.Commit();
+}
+
+void DatasetRegistry::LoadPersistedDatasets(DatabaseInstance &db) {
+	Connection con(db);
+	auto result = con.Query(StringUtil::Format("SELECT name, definition FROM %s", PERSISTENCE_TABLE));
+	if (result->HasError()) {
+		// Nothing has been persisted in this database yet
+		return;
+	}
+	vector<shared_ptr<SemanticDataset>> datasets;
+	for (idx_t row = 0; row < result->RowCount(); row++) {
+		auto name = result->GetValue(0, row).ToString();
+		try {
+			datasets.push_back(ParseSemanticDataset(name, result->GetValue(1, row).ToString()));
+		} catch (std::exception &) {
+			// A definition that no longer parses should not prevent the extension from loading
+			continue;
+		}
+	}
+	for (auto &dataset : datasets) {
+		InferDimensionTypes(con, *dataset);
+	}
+	LoadRollupState(con, datasets);
+	vector<string> published;
+	{
+		lock_guard<mutex> guard(write_lock_);
+		published = PublishDatasets(std::move(datasets));
+	}
+	WarmupDatasets(published);
+}
+
+std::shared_ptr<const DatasetRegistry::DatasetMap> DatasetRegistry::GetSnapshot() const {
+	return std::atomic_load(&snapshot_);
+}
+
+static bool ValidateFilterValues(const SemanticFilter &filter, string &error_msg) {
+	auto &op = filter.operator_;
+	idx_t min_values = 1;
+	idx_t max_values = 1;
+	if (op == "equals" || op == "not_equals" || op == "contains" || op == "starts_with") {
+		max_values = DConstants::INVALID_INDEX;
+	} else if (op == "between" || op == "in_date_range") {
+		min_values = max_values = 2;
+	} else if (op == "set" || op == "not_set") {
+		min_values = max_values = 0;
+	} else if (op != "gt" && op != "gte" && op != "lt" && op != "lte") {
+		error_msg = "Filter on '" + filter.dimension + "' has unsupported operator '" + op + "'";
+		return false;
+	}
+	auto count = filter.values.size();
+	if (count >= min_values && count <= max_values) {
+		return true;
+	}
+	string expected;
+	if (max_values == DConstants::INVALID_INDEX) {
+		expected = "at least one value";
+	} else if (max_values == 0) {
+		expected = "no values";
+	} else {
+		expected = StringUtil::Format("%d value%s", max_values, max_values == 1 ? "" : "s");
+	}
+	error_msg = "Filter on '" + filter.dimension + "' with operator '" + op + "' takes " + expected;
+	return false;
+}
+
+// Filters may also name a column of the source table that is not a dimension
+static bool BindFilters(const SemanticDataset &dataset, const vector<SemanticFilter> &filters,
+                        vector<optional_idx> &bound_filters, string &error_msg) {
+	for (const auto &filter : filters) {
+		if (filter.IsGroup()) {
+			if (!BindFilters(dataset, filter.filters, bound_filters, error_msg)) {
+				return false;
+			}
+			continue;
+		}
+		if (!ValidateFilterValues(filter, error_msg)) {
+			return false;
+		}
+		auto dimension_idx = dataset.FindDimension(filter.dimension);
+		// String matches compile to contains() and prefix(), which do not bind on other types
+		if (dimension_idx.IsValid() && (filter.operator_ == "contains" || filter.operator_ == "starts_with")) {
+			auto &type = dataset.dimensions[dimension_idx.GetIndex()].data_type;
+			if (type.id() != LogicalTypeId::VARCHAR && type.id() != LogicalTypeId::INVALID) {
+				error_msg = "Filter on '" + filter.dimension + "' with operator '" + filter.operator_ +
+				            "' needs a VARCHAR dimension, but '" + filter.dimension + "' is " + type.ToString();
+				return false;
+			}
+		}
+		bound_filters.push_back(dimension_idx);
+	}
+	return true;
+}
+
+bool DatasetRegistry::ValidateQuery(const SemanticQuery &query, BoundSemanticQuery &bound, string &error_msg) {
+	// Check if dataset exists
+	auto dataset = GetDataset(query.dataset);
+	if (!dataset) {
+		error_msg = "Dataset '" + query.dataset + "' not found in registry";
+		return false;
+	}
+
+	// Validate measures
+	bound.measures.reserve(query.measures.size());
+	for (const auto &measure_name : query.measures) {
+		auto measure_idx = dataset->FindMeasure(measure_name);
+		if (!measure_idx.IsValid()) {
+			error_msg = "Measure '" + measure_name + "' not found in dataset '" + query.dataset + "'";
+			return false;
+		}
+		bound.measures.push_back(measure_idx.GetIndex());
+	}
+
+	// Validate dimensions
+	bound.dimensions.reserve(query.dimensions.size());
+	for (const auto &dimension_name : query.dimensions) {
+		auto dimension_idx = dataset->FindDimension(dimension_name);
+		if (!dimension_idx.IsValid()) {
+			error_msg = "Dimension '" + dimension_name + "' not found in dataset '" + query.dataset + "'";
+			return false;
+		}
+		bound.dimensions.push_back(dimension_idx.GetIndex());
+	}
+
+	// Validate time dimensions
+	bound.time_dimensions.reserve(query.time_dimensions.size());
+	for (const auto &time_dim : query.time_dimensions) {
+		auto dimension_idx = dataset->FindDimension(time_dim.dimension);
+		if (!dimension_idx.IsValid()) {
+			error_msg = "Time dimension '" + time_dim.dimension + "' not found in dataset '" + query.dataset + "'";
+			return false;
+		}
+		// Without a granularity the time dimension is returned as it is
+		if (!time_dim.granularity.empty() && !IsSupportedGranularity(time_dim.granularity)) {
+			error_msg = "Time dimension '" + time_dim.dimension + "' has unsupported granularity '" +
+			            time_dim.granularity + "'";
+			return false;
+		}
+		if (!time_dim.date_range.empty() && time_dim.date_range.size() != 2) {
+			error_msg = "Time dimension '" + time_dim.dimension + "' needs a date_range of a start and an end date";
+			return false;
+		}
+		bound.time_dimensions.push_back(dimension_idx.GetIndex());
+	}
+
+	// Orders refer to the members the query returns, by the alias they are projected as
+	for (const auto &order : query.order) {
+		auto &id = order.id;
+		bool selected = std::find(query.measures.begin(), query.measures.end(), id) != query.measures.end() ||
+		                std::find(query.dimensions.begin(), query.dimensions.end(), id) != query.dimensions.end();
+		for (const auto &time_dim : query.time_dimensions) {
+			selected = selected || time_dim.dimension == id;
+		}
+		if (!selected) {
+			error_msg = "Order '" + id + "' is not a measure or dimension returned by the query";
+			return false;
+		}
+	}
+
+	if (!BindFilters(*dataset, query.filters, bound.filters, error_msg)) {
+		return false;
+	}
+
+	bound.dataset = std::move(dataset);
+	// Refuse queries whose hash table would not fit - every compiled plan passes here before it is cached, and
+	// changing the setting drops the cached plans
+	auto max_groups = GetMaxGroups();
+	auto groups = EstimateSemanticQueryGroups(query, bound);
+	if (max_groups > 0 && groups.IsValid() && groups.GetIndex() > max_groups) {
+		error_msg = StringUtil::Format("Semantic query on dataset '%s' is estimated to return %d groups, more than "
+		                               "semantic_max_groups (%d) - filter it further or raise the setting",
+		                               query.dataset, groups.GetIndex(), max_groups);
+		return false;
+	}
+	return true;
+}
+
+shared_ptr<const SemanticDataset> DatasetRegistry::GetDataset(const string &dataset_name) {
+	auto snapshot = GetSnapshot();
+	auto it = snapshot->find(dataset_name);
+	return it != snapshot->end() ? it->second : nullptr;
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
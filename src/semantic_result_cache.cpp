@@ -0,0 +1,283 @@
+#include "semantic_result_cache.hpp"
+#include "quack_extension.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/common/types/hash.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/catalog/catalog_search_path.hpp"
+#include "duckdb/main/client_data.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/main/connection.hpp"
+#include "duckdb/main/extension_util.hpp"
+#include "duckdb/parser/keyword_helper.hpp"
+#include "duckdb/parser/parsed_data/parse_info.hpp"
+#include "duckdb/parser/qualified_name.hpp"
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+bool SemanticResultCache::Enabled() {
+	lock_guard<mutex> guard(lock);
+	return memory_limit > 0;
+}
+
+shared_ptr<const SemanticCachedResult> SemanticResultCache::Lookup(const string &key, idx_t dataset_version,
+                                                                   const string &fingerprint) {
+	auto hash = Hash(key.c_str(), key.size());
+	lock_guard<mutex> guard(lock);
+	auto entry = index.find(hash);
+	if (entry == index.end() || entry->second->key != key) {
+		stats.misses++;
+		return nullptr;
+	}
+	if (entry->second->dataset_version != dataset_version || entry->second->fingerprint != fingerprint) {
+		// Computed from an older definition of the dataset or older contents of its source table
+		Erase(entry->second);
+		stats.invalidations++;
+		stats.misses++;
+		return nullptr;
+	}
+	if (Clock::now() >= entry->second->expires_at) {
+		Erase(entry->second);
+		stats.expirations++;
+		stats.misses++;
+		return nullptr;
+	}
+	stats.hits++;
+	// Move the entry to the front of the LRU list
+	entries.splice(entries.begin(), entries, entry->second);
+	return entry->second->result;
+}
+
+void SemanticResultCache::Insert(const string &key, const string &dataset, idx_t dataset_version,
+                                 const string &fingerprint, idx_t ttl_seconds,
+                                 shared_ptr<const SemanticCachedResult> result) {
+	auto hash = Hash(key.c_str(), key.size());
+	auto size = result->collection->AllocationSize();
+	lock_guard<mutex> guard(lock);
+	if (ttl_seconds == 0 || size > memory_limit) {
+		return;
+	}
+	auto existing = index.find(hash);
+	if (existing != index.end()) {
+		// Either a concurrent insert of the same query or a hash collision - keep the newest result
+		Erase(existing->second);
+	}
+	auto expires_at = Clock::now() + std::chrono::seconds(ttl_seconds);
+	entries.push_front(
+	    CacheEntry {hash, key, dataset, dataset_version, fingerprint, expires_at, size, std::move(result)});
+	index[hash] = entries.begin();
+	memory_usage += size;
+	EvictToLimit();
+}
+
+void SemanticResultCache::InvalidateDataset(const string &dataset) {
+	lock_guard<mutex> guard(lock);
+	for (auto it = entries.begin(); it != entries.end();) {
+		auto current = it++;
+		if (current->dataset == dataset) {
+			Erase(current);
+			stats.invalidations++;
+		}
+	}
+}
+
+void SemanticResultCache::SetMemoryLimit(idx_t memory_limit_p) {
+	lock_guard<mutex> guard(lock);
+	memory_limit = memory_limit_p;
+	EvictToLimit();
+}
+
+void SemanticResultCache::SetDefaultTTL(idx_t ttl_seconds) {
+	lock_guard<mutex> guard(lock);
+	default_ttl = ttl_seconds;
+}
+
+idx_t SemanticResultCache::GetDefaultTTL() {
+	lock_guard<mutex> guard(lock);
+	return default_ttl;
+}
+
+void SemanticResultCache::Erase(list<CacheEntry>::iterator entry) {
+	memory_usage -= entry->size;
+	index.erase(entry->hash);
+	entries.erase(entry);
+}
+
+void SemanticResultCache::EvictToLimit() {
+	while (memory_usage > memory_limit) {
+		Erase(std::prev(entries.end()));
+		stats.evictions++;
+	}
+}
+
+SemanticResultCacheStats SemanticResultCache::GetStats() {
+	lock_guard<mutex> guard(lock);
+	auto result = stats;
+	result.entries = entries.size();
+	result.memory_usage = memory_usage;
+	result.memory_limit = memory_limit;
+	return result;
+}
+
+unique_ptr<Connection> MakeSemanticSideConnection(ClientContext &context) {
+	auto con = make_uniq<Connection>(*context.db);
+	// Results depend on extension options such as TimeZone and Calendar, on variables and on the schemas that
+	// unqualified table names are looked up in
+	auto &config = con->context->config;
+	config.set_variables = context.config.set_variables;
+	config.user_variables = context.config.user_variables;
+	auto &search_path = ClientData::Get(context).catalog_search_path->GetSetPaths();
+	if (!search_path.empty()) {
+		auto set_search_path = StringUtil::Format(
+		    "SET search_path = %s", KeywordHelper::WriteQuoted(CatalogSearchEntry::ListToString(search_path)));
+		auto result = con->Query(set_search_path);
+		if (result->HasError()) {
+			result->ThrowError();
+		}
+	}
+	return con;
+}
+
+static string QualifiedTableSQL(const string &name) {
+	auto table_name = QualifiedName::Parse(name);
+	return ParseInfo::QualifierToString(table_name.catalog, table_name.schema, table_name.name);
+}
+
+// The row count of the source, and its refresh_key if it has one
+static string SourceFingerprintSQL(const string &from, const string &refresh_key) {
+	string fingerprint = "CAST(COUNT(*) AS VARCHAR)";
+	if (!refresh_key.empty()) {
+		fingerprint += StringUtil::Format(" || ':' || COALESCE(CAST(%s AS VARCHAR), '')", refresh_key);
+	}
+	return StringUtil::Format("(SELECT %s FROM %s)", fingerprint, from);
+}
+
+string CompileTableFingerprintSQL(const string &table_name, const string &refresh_key) {
+	return SourceFingerprintSQL(QualifiedTableSQL(table_name), refresh_key);
+}
+
+// Covers every table a plan of the dataset can read: its own (or just the rows of the source, if given), the joined
+// tables and the calendar table. Inserts and deletes change a row count. Updates that keep it are only noticed
+// through refresh keys, which have to change with every write (see SemanticDataset::refresh_key). Rollup tables are
+// left out, as a refresh of a rollup publishes a new version of the dataset.
+static string GetSourceFingerprint(Connection &con, const SemanticDataset &dataset, const string &source) {
+	vector<string> fingerprints;
+	fingerprints.push_back(
+	    SourceFingerprintSQL(source.empty() ? QualifiedTableSQL(dataset.name) : source, dataset.refresh_key));
+	for (auto &join : dataset.joins) {
+		fingerprints.push_back(CompileTableFingerprintSQL(join.table, join.refresh_key));
+	}
+	if (!dataset.calendar_table.empty()) {
+		fingerprints.push_back(CompileTableFingerprintSQL(dataset.calendar_table, string()));
+	}
+	auto result = con.Query("SELECT " + StringUtil::Join(fingerprints, " || '|' || "));
+	if (result->HasError()) {
+		result->ThrowError();
+	}
+	return result->GetValue(0, 0).ToString();
+}
+
+// The query runs on a separate connection, as the calling connection is busy running it. That connection only sees
+// committed data, so the cache is only used outside of explicit transactions (see SemanticQueryBindReplace).
+shared_ptr<const SemanticCachedResult> ExecuteCachedSemanticQuery(ClientContext &context,
+                                                                  const SemanticDataset &dataset, const string &sql,
+                                                                  const string &fingerprint_source) {
+	auto &cache = DatasetRegistry::Get(context).GetResultCache();
+	auto con = MakeSemanticSideConnection(context);
+	// The fingerprint and the result are read from the same snapshot
+	con->BeginTransaction();
+	auto fingerprint = GetSourceFingerprint(*con, dataset, fingerprint_source);
+	auto cached = cache.Lookup(sql, dataset.version, fingerprint);
+	if (cached) {
+		con->Commit();
+		return cached;
+	}
+	auto query_result = con->Query(sql);
+	if (query_result->HasError()) {
+		query_result->ThrowError();
+	}
+	con->Commit();
+
+	auto result = make_shared_ptr<SemanticCachedResult>();
+	result->names = query_result->names;
+	result->types = query_result->types;
+	result->collection = query_result->TakeCollection();
+	auto ttl = dataset.result_cache_ttl.IsValid() ? dataset.result_cache_ttl.GetIndex() : cache.GetDefaultTTL();
+	cache.Insert(sql, dataset.name, dataset.version, fingerprint, ttl, result);
+	return std::move(result);
+}
+
+// semantic_result_cache_memory_limit and semantic_result_cache_ttl settings
+static void SetSemanticResultCacheMemoryLimit(ClientContext &context, SetScope scope, Value &parameter) {
+	auto limit = parameter.GetValue<int64_t>();
+	if (limit < 0) {
+		throw InvalidInputException("semantic_result_cache_memory_limit must be non-negative");
+	}
+	DatasetRegistry::Get(context).GetResultCache().SetMemoryLimit(NumericCast<idx_t>(limit));
+}
+
+static void SetSemanticResultCacheTTL(ClientContext &context, SetScope scope, Value &parameter) {
+	auto ttl = parameter.GetValue<int64_t>();
+	if (ttl < 0) {
+		throw InvalidInputException("semantic_result_cache_ttl must be non-negative");
+	}
+	DatasetRegistry::Get(context).GetResultCache().SetDefaultTTL(NumericCast<idx_t>(ttl));
+}
+
+// semantic_result_cache_stats() table function
+struct SemanticResultCacheStatsState : public GlobalTableFunctionState {
+	bool finished = false;
+};
+
+static unique_ptr<FunctionData> SemanticResultCacheStatsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                             vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"hits", "misses", "evictions", "invalidations", "expirations", "entries", "memory_usage", "memory_limit"};
+	return_types = {LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT};
+	return make_uniq<TableFunctionData>();
+}
+
+static unique_ptr<GlobalTableFunctionState> SemanticResultCacheStatsInit(ClientContext &context,
+                                                                         TableFunctionInitInput &input) {
+	return make_uniq<SemanticResultCacheStatsState>();
+}
+
+static void SemanticResultCacheStatsFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<SemanticResultCacheStatsState>();
+	if (state.finished) {
+		output.SetCardinality(0);
+		return;
+	}
+	auto stats = DatasetRegistry::Get(context).GetResultCache().GetStats();
+	output.SetCardinality(1);
+	output.SetValue(0, 0, Value::UBIGINT(stats.hits));
+	output.SetValue(1, 0, Value::UBIGINT(stats.misses));
+	output.SetValue(2, 0, Value::UBIGINT(stats.evictions));
+	output.SetValue(3, 0, Value::UBIGINT(stats.invalidations));
+	output.SetValue(4, 0, Value::UBIGINT(stats.expirations));
+	output.SetValue(5, 0, Value::UBIGINT(stats.entries));
+	output.SetValue(6, 0, Value::UBIGINT(stats.memory_usage));
+	output.SetValue(7, 0, Value::UBIGINT(stats.memory_limit));
+	state.finished = true;
+}
+
+void RegisterSemanticResultCacheFunctions(DatabaseInstance &instance) {
+	auto &config = DBConfig::GetConfig(instance);
+	config.AddExtensionOption("semantic_result_cache_memory_limit",
+	                          "Memory budget in bytes for cached semantic query results (0 disables the cache)",
+	                          LogicalType::BIGINT, Value::BIGINT(0), SetSemanticResultCacheMemoryLimit);
+	config.AddExtensionOption("semantic_result_cache_ttl",
+	                          "Seconds a cached semantic query result is served, for datasets without a "
+	                          "\"result_cache_ttl\"",
+	                          LogicalType::BIGINT, Value::BIGINT(SemanticResultCache::DEFAULT_TTL_SECONDS),
+	                          SetSemanticResultCacheTTL);
+
+	TableFunction stats_func("semantic_result_cache_stats", {}, SemanticResultCacheStatsFunction,
+	                         SemanticResultCacheStatsBind, SemanticResultCacheStatsInit);
+	ExtensionUtil::RegisterFunction(instance, stats_func);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
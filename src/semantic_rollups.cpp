@@ -0,0 +1,535 @@
+#include "quack_extension.hpp"
+#include "semantic_result_cache.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/profiler.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/main/connection.hpp"
+#include "duckdb/main/extension_util.hpp"
+#include "duckdb/parser/keyword_helper.hpp"
+#include "duckdb/parser/tableref.hpp"
+
+#include <algorithm>
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+//===--------------------------------------------------------------------===//
+// Query routing
+//===--------------------------------------------------------------------===//
+static bool Contains(const vector<idx_t> &indexes, idx_t index) {
+	return std::find(indexes.begin(), indexes.end(), index) != indexes.end();
+}
+
+// Whether the rollup holds everything the query needs, and whether its measures have to be aggregated again
+static bool RollupCovers(const SemanticQuery &query, const BoundSemanticQuery &bound, const SemanticRollup &rollup,
+                         bool &reaggregate) {
+	auto &dataset = *bound.dataset;
+	for (auto measure_idx : bound.measures) {
+		if (!Contains(rollup.measure_indexes, measure_idx)) {
+			return false;
+		}
+	}
+	// Every dimension the query groups or filters by has to be a column of the rollup
+	vector<idx_t> grouped_dimensions;
+	for (auto dimension_idx : bound.dimensions) {
+		if (!Contains(rollup.dimension_indexes, dimension_idx)) {
+			return false;
+		}
+		if (!Contains(grouped_dimensions, dimension_idx)) {
+			grouped_dimensions.push_back(dimension_idx);
+		}
+	}
+	for (auto &dimension_idx : bound.filters) {
+		if (!dimension_idx.IsValid() || !Contains(rollup.dimension_indexes, dimension_idx.GetIndex())) {
+			return false;
+		}
+	}
+	// Time dimensions can be rolled up further, but never broken down below the rollup granularity
+	bool same_time_grain = true;
+	for (idx_t i = 0; i < query.time_dimensions.size(); i++) {
+		auto &time_dim = query.time_dimensions[i];
+		auto &rollup_time_dimension = rollup.time_dimension_index;
+		if (!rollup_time_dimension.IsValid() || rollup_time_dimension.GetIndex() != bound.time_dimensions[i]) {
+			return false;
+		}
+		if (!GranularityRollsUp(rollup.granularity, time_dim.granularity)) {
+			return false;
+		}
+		// Date ranges compare the stored (truncated) values, which only matches the raw values down to whole days
+		if (!time_dim.date_range.empty() && rollup.granularity != "day" && rollup.granularity != "hour") {
+			return false;
+		}
+		// Rollups truncate instants in UTC, not in the query's time zone
+		if (!query.time_zone.empty() &&
+		    dataset.dimensions[bound.time_dimensions[i]].data_type.id() == LogicalTypeId::TIMESTAMP_TZ) {
+			return false;
+		}
+		same_time_grain = same_time_grain && time_dim.granularity == rollup.granularity;
+	}
+	bool same_grouping = grouped_dimensions.size() == rollup.dimension_indexes.size() &&
+	                     (query.time_dimensions.empty() ? !rollup.time_dimension_index.IsValid() : same_time_grain);
+	reaggregate = !same_grouping;
+	// The rollup is grouped by more than the query, so its measures have to combine
+	if (reaggregate) {
+		for (auto measure_idx : bound.measures) {
+			if (!IsCombinableMeasure(dataset.measures[measure_idx])) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void RouteSemanticQuery(const SemanticQuery &query, BoundSemanticQuery &bound) {
+	auto &dataset = *bound.dataset;
+	// Queries without measures return the raw rows, which a rollup does not have
+	if (dataset.rollups.empty() || bound.measures.empty()) {
+		return;
+	}
+	for (idx_t i = 0; i < dataset.rollups.size(); i++) {
+		auto &rollup = dataset.rollups[i];
+		bool reaggregate;
+		if (!rollup.materialized || !RollupCovers(query, bound, rollup, reaggregate)) {
+			continue;
+		}
+		if (!bound.rollup.IsValid() || rollup.row_count < dataset.rollups[bound.rollup.GetIndex()].row_count) {
+			bound.rollup = i;
+			bound.reaggregate_rollup = reaggregate;
+		}
+	}
+}
+
+//===--------------------------------------------------------------------===//
+// Materialization and refresh
+//===--------------------------------------------------------------------===//
+// Rollups are built through a side connection (see DatasetRegistry::PersistDatasets). Statements with parameters
+// are prepared, so partition keys never have to be escaped into SQL text.
+static unique_ptr<MaterializedQueryResult> RunRollupQuery(Connection &con, const string &sql,
+                                                          vector<Value> values = vector<Value>()) {
+	unique_ptr<QueryResult> result;
+	if (values.empty()) {
+		result = con.Query(sql);
+	} else {
+		auto statement = con.Prepare(sql);
+		if (statement->HasError()) {
+			throw InvalidInputException("Failed to build rollups: %s", statement->GetError());
+		}
+		result = statement->Execute(values, false);
+	}
+	if (result->HasError()) {
+		throw InvalidInputException("Failed to build rollups: %s", result->GetError());
+	}
+	return unique_ptr_cast<QueryResult, MaterializedQueryResult>(std::move(result));
+}
+
+// The rollup is the semantic query of its own members against the base table
+static string CompileRollupSQL(const shared_ptr<const SemanticDataset> &dataset, const SemanticRollup &rollup) {
+	SemanticQuery query;
+	query.dataset = dataset->name;
+	query.measures = rollup.measures;
+	query.dimensions = rollup.dimensions;
+	query.limit = -1;
+	BoundSemanticQuery bound;
+	bound.dataset = dataset;
+	bound.measures = rollup.measure_indexes;
+	bound.dimensions = rollup.dimension_indexes;
+	if (rollup.time_dimension_index.IsValid()) {
+		SemanticTimeDimension time_dim;
+		time_dim.dimension = rollup.time_dimension;
+		time_dim.granularity = rollup.granularity;
+		query.time_dimensions.push_back(std::move(time_dim));
+		bound.time_dimensions.push_back(rollup.time_dimension_index.GetIndex());
+	}
+	return CompileSemanticQueryToSQL(query, bound);
+}
+
+// Partitions are identified by their truncated time value as text, '' for rows without a time value
+static string PartitionKey(const string &time_sql) {
+	return StringUtil::Format("COALESCE(CAST(%s AS VARCHAR), '')", time_sql);
+}
+
+static idx_t CountRows(Connection &con, const string &table_name) {
+	auto result = RunRollupQuery(con, StringUtil::Format("SELECT COUNT(*) FROM %s", table_name));
+	return result->GetValue(0, 0).GetValue<idx_t>();
+}
+
+// The joined tables the members of the rollup read - sorted, without duplicates
+static vector<idx_t> RollupJoins(const SemanticDataset &dataset, const SemanticRollup &rollup) {
+	vector<idx_t> joins;
+	for (auto measure_idx : rollup.measure_indexes) {
+		auto &measure_joins = dataset.measures[measure_idx].joins;
+		joins.insert(joins.end(), measure_joins.begin(), measure_joins.end());
+	}
+	auto dimension_indexes = rollup.dimension_indexes;
+	if (rollup.time_dimension_index.IsValid()) {
+		dimension_indexes.push_back(rollup.time_dimension_index.GetIndex());
+	}
+	for (auto dimension_idx : dimension_indexes) {
+		auto &dimension_joins = dataset.dimensions[dimension_idx].joins;
+		joins.insert(joins.end(), dimension_joins.begin(), dimension_joins.end());
+	}
+	std::sort(joins.begin(), joins.end());
+	joins.erase(std::unique(joins.begin(), joins.end()), joins.end());
+	return joins;
+}
+
+// Fingerprint of every time partition of the base table: its row count and the dataset's refresh_key. A change to a
+// joined table can move rows of any partition to other groups, so the fingerprint of the joined tables is part of
+// every partition's, and such a change recomputes them all.
+static unordered_map<string, string> ComputeFingerprints(Connection &con, const SemanticDataset &dataset,
+                                                         const SemanticRollup &rollup) {
+	string joins_fingerprint;
+	auto joins = RollupJoins(dataset, rollup);
+	if (!joins.empty()) {
+		vector<string> join_fingerprints;
+		for (auto join_idx : joins) {
+			auto &join = dataset.joins[join_idx];
+			join_fingerprints.push_back(CompileTableFingerprintSQL(join.table, join.refresh_key));
+		}
+		auto result = RunRollupQuery(con, "SELECT " + StringUtil::Join(join_fingerprints, " || '|' || "));
+		joins_fingerprint = "|" + result->GetValue(0, 0).ToString();
+	}
+	auto &time_dimension = dataset.dimensions[rollup.time_dimension_index.GetIndex()];
+	auto partition = PartitionKey(
+	    StringUtil::Format("date_trunc('%s', %s)", rollup.granularity, time_dimension.expression->ToString()));
+	string fingerprint = "CAST(COUNT(*) AS VARCHAR)";
+	if (!dataset.refresh_key.empty()) {
+		fingerprint += StringUtil::Format(" || ':' || COALESCE(CAST(%s AS VARCHAR), '')", dataset.refresh_key);
+	}
+	// The time dimension may be a column of a join
+	auto source = CompileDatasetSource(dataset, time_dimension.joins, vector<idx_t>());
+	auto result = RunRollupQuery(
+	    con, StringUtil::Format("SELECT %s, %s FROM %s GROUP BY 1", partition, fingerprint, source->ToString()));
+	unordered_map<string, string> fingerprints;
+	for (idx_t row = 0; row < result->RowCount(); row++) {
+		fingerprints[result->GetValue(0, row).ToString()] = result->GetValue(1, row).ToString() + joins_fingerprint;
+	}
+	return fingerprints;
+}
+
+static unordered_map<string, string> LoadFingerprints(Connection &con, const SemanticDataset &dataset,
+                                                      const SemanticRollup &rollup) {
+	auto result = RunRollupQuery(con,
+	                             StringUtil::Format("SELECT partition_key, fingerprint FROM %s "
+	                                                "WHERE dataset = $1 AND rollup = $2",
+	                                                DatasetRegistry::ROLLUP_PARTITIONS_TABLE),
+	                             {Value(dataset.name), Value(rollup.name)});
+	unordered_map<string, string> fingerprints;
+	for (idx_t row = 0; row < result->RowCount(); row++) {
+		fingerprints[result->GetValue(0, row).ToString()] = result->GetValue(1, row).ToString();
+	}
+	return fingerprints;
+}
+
+static void SaveFingerprints(Connection &con, const SemanticDataset &dataset, const SemanticRollup &rollup,
+                             vector<Value> partition_keys, vector<Value> fingerprints) {
+	if (partition_keys.empty()) {
+		return;
+	}
+	RunRollupQuery(con,
+	               StringUtil::Format("INSERT INTO %s SELECT $1, $2, UNNEST($3::VARCHAR[]), UNNEST($4::VARCHAR[])",
+	                                  DatasetRegistry::ROLLUP_PARTITIONS_TABLE),
+	               {Value(dataset.name), Value(rollup.name),
+	                Value::LIST(LogicalType::VARCHAR, std::move(partition_keys)),
+	                Value::LIST(LogicalType::VARCHAR, std::move(fingerprints))});
+}
+
+// Recomputes the whole rollup
+static void BuildRollup(Connection &con, const shared_ptr<SemanticDataset> &dataset, SemanticRollup &rollup,
+                        SemanticRollupRefresh &refresh) {
+	RunRollupQuery(con, StringUtil::Format("CREATE OR REPLACE TABLE %s AS %s", rollup.table_name,
+	                                       CompileRollupSQL(dataset, rollup)));
+	RunRollupQuery(con,
+	               StringUtil::Format("DELETE FROM %s WHERE dataset = $1 AND rollup = $2",
+	                                  DatasetRegistry::ROLLUP_PARTITIONS_TABLE),
+	               {Value(dataset->name), Value(rollup.name)});
+	refresh.partitions = 1;
+	if (rollup.time_dimension_index.IsValid()) {
+		// Computed in the same transaction, so the fingerprints describe exactly the rows that were aggregated
+		vector<Value> partition_keys;
+		vector<Value> fingerprints;
+		for (auto &entry : ComputeFingerprints(con, *dataset, rollup)) {
+			partition_keys.emplace_back(entry.first);
+			fingerprints.emplace_back(entry.second);
+		}
+		refresh.partitions = partition_keys.size();
+		SaveFingerprints(con, *dataset, rollup, std::move(partition_keys), std::move(fingerprints));
+	}
+	rollup.row_count = CountRows(con, rollup.table_name);
+	refresh.rows = rollup.row_count;
+}
+
+// Recomputes only the time partitions whose fingerprint changed, and drops the partitions that no longer exist
+static void RefreshRollupPartitions(Connection &con, const shared_ptr<SemanticDataset> &dataset,
+                                    SemanticRollup &rollup, SemanticRollupRefresh &refresh) {
+	auto current = ComputeFingerprints(con, *dataset, rollup);
+	auto stored = LoadFingerprints(con, *dataset, rollup);
+	vector<Value> changed_keys;
+	vector<Value> changed_fingerprints;
+	vector<Value> touched_keys;
+	for (auto &entry : current) {
+		auto stored_entry = stored.find(entry.first);
+		if (stored_entry == stored.end() || stored_entry->second != entry.second) {
+			changed_keys.emplace_back(entry.first);
+			changed_fingerprints.emplace_back(entry.second);
+			touched_keys.emplace_back(entry.first);
+		}
+	}
+	for (auto &entry : stored) {
+		if (current.find(entry.first) == current.end()) {
+			touched_keys.emplace_back(entry.first);
+		}
+	}
+	refresh.partitions = touched_keys.size();
+	if (touched_keys.empty()) {
+		return;
+	}
+
+	auto touched = Value::LIST(LogicalType::VARCHAR, std::move(touched_keys));
+	auto rollup_partition = PartitionKey(KeywordHelper::WriteOptionallyQuoted(rollup.time_dimension));
+	RunRollupQuery(con,
+	               StringUtil::Format("DELETE FROM %s WHERE %s IN (SELECT UNNEST($1::VARCHAR[]))", rollup.table_name,
+	                                  rollup_partition),
+	               {touched});
+	RunRollupQuery(con,
+	               StringUtil::Format("DELETE FROM %s WHERE dataset = $1 AND rollup = $2 "
+	                                  "AND partition_key IN (SELECT UNNEST($3::VARCHAR[]))",
+	                                  DatasetRegistry::ROLLUP_PARTITIONS_TABLE),
+	               {Value(dataset->name), Value(rollup.name), touched});
+	if (!changed_keys.empty()) {
+		// Filters on the partition key are pushed below the aggregate, so only the changed partitions are scanned
+		auto inserted = RunRollupQuery(
+		    con,
+		    StringUtil::Format("INSERT INTO %s SELECT * FROM (%s) WHERE %s IN (SELECT UNNEST($1::VARCHAR[]))",
+		                       rollup.table_name, CompileRollupSQL(dataset, rollup), rollup_partition),
+		    {Value::LIST(LogicalType::VARCHAR, changed_keys)});
+		refresh.rows = inserted->GetValue(0, 0).GetValue<idx_t>();
+		SaveFingerprints(con, *dataset, rollup, std::move(changed_keys), std::move(changed_fingerprints));
+	}
+	rollup.row_count = CountRows(con, rollup.table_name);
+}
+
+vector<SemanticRollupRefresh> DatasetRegistry::RefreshRollups(DatabaseInstance &db, const vector<string> &dataset_names,
+                                                               bool full_rebuild) {
+	if (DBConfig::GetConfig(db).options.access_mode == AccessMode::READ_ONLY) {
+		throw InvalidInputException("Cannot build rollups in a read-only database");
+	}
+	// Builds write the same tables, so they run one at a time - but without the write lock, which registrations and
+	// other refreshes only wait for while a built dataset is published
+	lock_guard<mutex> build_guard(rollup_lock_);
+	Connection con(db);
+	RunRollupQuery(con, StringUtil::Format("CREATE TABLE IF NOT EXISTS %s (dataset VARCHAR, rollup VARCHAR, "
+	                                       "definition VARCHAR NOT NULL, row_count UBIGINT NOT NULL, "
+	                                       "PRIMARY KEY (dataset, rollup))",
+	                                       ROLLUP_STATE_TABLE));
+	RunRollupQuery(con, StringUtil::Format("CREATE TABLE IF NOT EXISTS %s (dataset VARCHAR, rollup VARCHAR, "
+	                                       "partition_key VARCHAR, fingerprint VARCHAR NOT NULL, "
+	                                       "PRIMARY KEY (dataset, rollup, partition_key))",
+	                                       ROLLUP_PARTITIONS_TABLE));
+
+	vector<SemanticRollupRefresh> result;
+	for (auto &dataset_name : dataset_names) {
+		auto current = GetDataset(dataset_name);
+		if (!current) {
+			throw InvalidInputException("Dataset '%s' not found in registry", dataset_name);
+		}
+		// Published datasets are immutable, the materialized state goes into a new version of the dataset
+		shared_ptr<SemanticDataset> dataset = ParseSemanticDataset(current->name, current->definition);
+		if (dataset->rollups.empty()) {
+			continue;
+		}
+		for (idx_t i = 0; i < dataset->dimensions.size(); i++) {
+			dataset->dimensions[i].data_type = current->dimensions[i].data_type;
+		}
+		// Each dataset is refreshed in its own transaction, and published once it is committed
+		con.BeginTransaction();
+		try {
+			for (idx_t i = 0; i < dataset->rollups.size(); i++) {
+				auto &rollup = dataset->rollups[i];
+				auto &current_rollup = current->rollups[i];
+				SemanticRollupRefresh refresh;
+				refresh.dataset = dataset->name;
+				refresh.rollup = rollup.name;
+				refresh.table_name = rollup.table_name;
+				Profiler profiler;
+				profiler.Start();
+				if (full_rebuild || !current_rollup.materialized || !rollup.time_dimension_index.IsValid()) {
+					BuildRollup(con, dataset, rollup, refresh);
+				} else {
+					rollup.row_count = current_rollup.row_count;
+					RefreshRollupPartitions(con, dataset, rollup, refresh);
+				}
+				rollup.materialized = true;
+				RunRollupQuery(con, StringUtil::Format("INSERT OR REPLACE INTO %s VALUES ($1, $2, $3, $4)",
+				                                       ROLLUP_STATE_TABLE),
+				               {Value(dataset->name), Value(rollup.name), Value(dataset->definition),
+				                Value::UBIGINT(rollup.row_count)});
+				profiler.End();
+				refresh.row_count = rollup.row_count;
+				refresh.duration = profiler.Elapsed();
+				result.push_back(std::move(refresh));
+			}
+			con.Commit();
+		} catch (...) {
+			if (con.HasActiveTransaction()) {
+				con.Rollback();
+			}
+			throw;
+		}
+		vector<string> published;
+		{
+			lock_guard<mutex> guard(write_lock_);
+			// A dataset registered again during the build keeps its new definition: the state table records the
+			// definition the tables were built from, so they are not used for the new one
+			auto latest = GetDataset(dataset_name);
+			if (!latest || latest->definition != dataset->definition) {
+				continue;
+			}
+			// Statistics may have been refreshed during the build
+			dataset->statistics = latest->statistics;
+			vector<shared_ptr<SemanticDataset>> datasets;
+			datasets.push_back(std::move(dataset));
+			published = PublishDatasets(std::move(datasets));
+		}
+		WarmupDatasets(published);
+	}
+	return result;
+}
+
+void DatasetRegistry::LoadRollupState(Connection &con, vector<shared_ptr<SemanticDataset>> &datasets) {
+	auto result =
+	    con.Query(StringUtil::Format("SELECT dataset, rollup, definition, row_count FROM %s", ROLLUP_STATE_TABLE));
+	if (result->HasError()) {
+		// No rollups have been materialized in this database yet
+		return;
+	}
+	unordered_map<string, SemanticDataset *> datasets_by_name;
+	for (auto &dataset : datasets) {
+		datasets_by_name[dataset->name] = dataset.get();
+	}
+	for (idx_t row = 0; row < result->RowCount(); row++) {
+		auto entry = datasets_by_name.find(result->GetValue(0, row).ToString());
+		// Tables built from an older definition of the dataset are not used until they are rebuilt
+		if (entry == datasets_by_name.end() || entry->second->definition != result->GetValue(2, row).ToString()) {
+			continue;
+		}
+		auto rollup_name = result->GetValue(1, row).ToString();
+		for (auto &rollup : entry->second->rollups) {
+			if (rollup.name == rollup_name) {
+				rollup.materialized = true;
+				rollup.row_count = result->GetValue(3, row).GetValue<idx_t>();
+			}
+		}
+	}
+}
+
+//===--------------------------------------------------------------------===//
+// materialize_semantic_rollups(dataset) and refresh_semantic_rollups([dataset]) table functions
+//===--------------------------------------------------------------------===//
+struct RefreshRollupsData : public TableFunctionData {
+	//! Empty for all datasets that declare rollups
+	vector<string> datasets;
+	bool full_rebuild = false;
+};
+
+struct RefreshRollupsState : public GlobalTableFunctionState {
+	bool refreshed = false;
+	vector<SemanticRollupRefresh> refreshes;
+	idx_t offset = 0;
+};
+
+static unique_ptr<FunctionData> MaterializeRollupsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                       vector<LogicalType> &return_types, vector<string> &names) {
+	auto result = make_uniq<RefreshRollupsData>();
+	result->datasets.push_back(input.inputs[0].GetValue<string>());
+	result->full_rebuild = true;
+	names = {"rollup", "table_name", "row_count"};
+	return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::UBIGINT};
+	return std::move(result);
+}
+
+static unique_ptr<FunctionData> RefreshRollupsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                   vector<LogicalType> &return_types, vector<string> &names) {
+	auto result = make_uniq<RefreshRollupsData>();
+	if (!input.inputs.empty()) {
+		result->datasets.push_back(input.inputs[0].GetValue<string>());
+	}
+	names = {"dataset", "rollup", "partitions", "rows", "duration_ms"};
+	return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::DOUBLE};
+	return std::move(result);
+}
+
+static unique_ptr<GlobalTableFunctionState> RefreshRollupsInit(ClientContext &context, TableFunctionInitInput &input) {
+	return make_uniq<RefreshRollupsState>();
+}
+
+static void RunRefresh(ClientContext &context, const RefreshRollupsData &data, RefreshRollupsState &state) {
+	if (state.refreshed) {
+		return;
+	}
+	state.refreshed = true;
+	auto &registry = DatasetRegistry::Get(context);
+	auto datasets = data.datasets;
+	if (datasets.empty()) {
+		for (auto &entry : *registry.GetSnapshot()) {
+			if (!entry.second->rollups.empty()) {
+				datasets.push_back(entry.first);
+			}
+		}
+		std::sort(datasets.begin(), datasets.end());
+	}
+	state.refreshes = registry.RefreshRollups(*context.db, datasets, data.full_rebuild);
+}
+
+static void MaterializeRollupsFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<RefreshRollupsState>();
+	RunRefresh(context, data_p.bind_data->Cast<RefreshRollupsData>(), state);
+
+	idx_t count = 0;
+	while (state.offset < state.refreshes.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &refresh = state.refreshes[state.offset++];
+		output.SetValue(0, count, Value(refresh.rollup));
+		output.SetValue(1, count, Value(refresh.table_name));
+		output.SetValue(2, count, Value::UBIGINT(refresh.row_count));
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+static void RefreshRollupsFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<RefreshRollupsState>();
+	RunRefresh(context, data_p.bind_data->Cast<RefreshRollupsData>(), state);
+
+	idx_t count = 0;
+	while (state.offset < state.refreshes.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &refresh = state.refreshes[state.offset++];
+		output.SetValue(0, count, Value(refresh.dataset));
+		output.SetValue(1, count, Value(refresh.rollup));
+		output.SetValue(2, count, Value::UBIGINT(refresh.partitions));
+		output.SetValue(3, count, Value::UBIGINT(refresh.rows));
+		output.SetValue(4, count, Value::DOUBLE(refresh.duration * 1000.0));
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+void RegisterSemanticRollupFunctions(DatabaseInstance &instance) {
+	TableFunction materialize_rollups("materialize_semantic_rollups", {LogicalType::VARCHAR},
+	                                  MaterializeRollupsFunction, MaterializeRollupsBind, RefreshRollupsInit);
+	ExtensionUtil::RegisterFunction(instance, materialize_rollups);
+
+	TableFunctionSet refresh_rollups("refresh_semantic_rollups");
+	refresh_rollups.AddFunction(
+	    TableFunction({}, RefreshRollupsFunction, RefreshRollupsBind, RefreshRollupsInit));
+	refresh_rollups.AddFunction(
+	    TableFunction({LogicalType::VARCHAR}, RefreshRollupsFunction, RefreshRollupsBind, RefreshRollupsInit));
+	ExtensionUtil::RegisterFunction(instance, refresh_rollups);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
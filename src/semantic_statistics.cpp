@@ -0,0 +1,396 @@
+#include "quack_extension.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/numeric_utils.hpp"
+#include "duckdb/common/profiler.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/interval.hpp"
+#include "duckdb/common/types/timestamp.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/main/connection.hpp"
+#include "duckdb/main/extension_util.hpp"
+#include "duckdb/parser/tableref.hpp"
+
+#include <algorithm>
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+//===--------------------------------------------------------------------===//
+// Dataset statistics
+//===--------------------------------------------------------------------===//
+// refresh_semantic_dataset_stats([dataset]) scans the rows of datasets once for their row count, the approximate
+// number of distinct values of every dimension (approx_count_distinct, a HyperLogLog sketch) and the range of their
+// date and timestamp dimensions. Like materialized rollups, the statistics go into a new version of the dataset, so
+// cached plans, which were compiled without them, are dropped. They are kept in memory only, and a re-registration
+// drops them with the definition they were computed for. Compilation uses them to predict the number of groups of a
+// query and refuses queries above semantic_max_groups, whose hash tables would not fit in memory.
+static bool IsTemporal(const LogicalType &type) {
+	switch (type.id()) {
+	case LogicalTypeId::DATE:
+	case LogicalTypeId::TIMESTAMP:
+	case LogicalTypeId::TIMESTAMP_TZ:
+	case LogicalTypeId::TIMESTAMP_SEC:
+	case LogicalTypeId::TIMESTAMP_MS:
+	case LogicalTypeId::TIMESTAMP_NS:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static shared_ptr<const SemanticDatasetStatistics> ComputeStatistics(Connection &con, const SemanticDataset &dataset) {
+	vector<string> select_list {"count(*)"};
+	vector<idx_t> joins;
+	for (auto &dimension : dataset.dimensions) {
+		auto expression = dimension.expression->ToString();
+		select_list.push_back(StringUtil::Format("approx_count_distinct(%s)", expression));
+		if (IsTemporal(dimension.data_type)) {
+			select_list.push_back(StringUtil::Format("CAST(min(%s) AS TIMESTAMP)", expression));
+			select_list.push_back(StringUtil::Format("CAST(max(%s) AS TIMESTAMP)", expression));
+		}
+		joins.insert(joins.end(), dimension.joins.begin(), dimension.joins.end());
+	}
+	std::sort(joins.begin(), joins.end());
+	joins.erase(std::unique(joins.begin(), joins.end()), joins.end());
+	auto source = CompileDatasetSource(dataset, joins, vector<idx_t>());
+	auto result = con.Query(
+	    StringUtil::Format("SELECT %s FROM %s", StringUtil::Join(select_list, ", "), source->ToString()));
+	if (result->HasError()) {
+		throw InvalidInputException("Failed to compute the statistics of dataset '%s': %s", dataset.name,
+		                            result->GetError());
+	}
+
+	auto statistics = make_shared_ptr<SemanticDatasetStatistics>();
+	statistics->row_count = result->GetValue(0, 0).GetValue<idx_t>();
+	idx_t col = 1;
+	for (auto &dimension : dataset.dimensions) {
+		statistics->cardinalities.push_back(result->GetValue(col++, 0).GetValue<idx_t>());
+		if (IsTemporal(dimension.data_type)) {
+			statistics->min_values.push_back(result->GetValue(col++, 0));
+			statistics->max_values.push_back(result->GetValue(col++, 0));
+		} else {
+			statistics->min_values.emplace_back(LogicalType::TIMESTAMP);
+			statistics->max_values.emplace_back(LogicalType::TIMESTAMP);
+		}
+	}
+	statistics->analyzed_at = Timestamp::GetCurrentTimestamp();
+	return std::move(statistics);
+}
+
+vector<SemanticStatisticsRefresh> DatasetRegistry::RefreshStatistics(DatabaseInstance &db,
+                                                                     const vector<string> &dataset_names) {
+	// The statistics are computed without the write lock, so registrations and rollup refreshes do not wait for the
+	// scans
+	Connection con(db);
+	vector<SemanticStatisticsRefresh> result;
+	vector<shared_ptr<SemanticDataset>> datasets;
+	for (auto &dataset_name : dataset_names) {
+		auto current = GetDataset(dataset_name);
+		if (!current) {
+			throw InvalidInputException("Dataset '%s' not found in registry", dataset_name);
+		}
+		Profiler profiler;
+		profiler.Start();
+		// Published datasets are immutable - the new version keeps the inferred types
+		shared_ptr<SemanticDataset> dataset = ParseSemanticDataset(current->name, current->definition);
+		for (idx_t i = 0; i < dataset->dimensions.size(); i++) {
+			dataset->dimensions[i].data_type = current->dimensions[i].data_type;
+		}
+		dataset->statistics = ComputeStatistics(con, *dataset);
+		profiler.End();
+
+		SemanticStatisticsRefresh refresh;
+		refresh.dataset = dataset->name;
+		refresh.row_count = dataset->statistics->row_count;
+		refresh.duration = profiler.Elapsed();
+		result.push_back(std::move(refresh));
+		datasets.push_back(std::move(dataset));
+	}
+
+	vector<string> published_names;
+	{
+		lock_guard<mutex> guard(write_lock_);
+		vector<shared_ptr<SemanticDataset>> published;
+		for (auto &dataset : datasets) {
+			// Statistics of a dataset that was registered again with another definition describe the previous one
+			auto latest = GetDataset(dataset->name);
+			if (!latest || latest->definition != dataset->definition) {
+				continue;
+			}
+			// The rollup state of the latest version, which rollup refreshes may have published since
+			for (idx_t i = 0; i < dataset->rollups.size(); i++) {
+				dataset->rollups[i].materialized = latest->rollups[i].materialized;
+				dataset->rollups[i].row_count = latest->rollups[i].row_count;
+			}
+			published.push_back(std::move(dataset));
+		}
+		published_names = PublishDatasets(std::move(published));
+	}
+	WarmupDatasets(published_names);
+	return result;
+}
+
+// Shortest length of a period of the granularity, so that the number of periods in a range is not underestimated
+static int64_t MinimumPeriodMicros(const string &granularity) {
+	if (granularity == "hour") {
+		return Interval::MICROS_PER_HOUR;
+	}
+	if (granularity == "day") {
+		return Interval::MICROS_PER_DAY;
+	}
+	if (granularity == "week") {
+		return 7 * Interval::MICROS_PER_DAY;
+	}
+	if (granularity == "month") {
+		return 28 * Interval::MICROS_PER_DAY;
+	}
+	if (granularity == "quarter" || granularity == "fiscal_quarter") {
+		return 89 * Interval::MICROS_PER_DAY;
+	}
+	return 365 * Interval::MICROS_PER_DAY;
+}
+
+static bool TryGetTimestamp(const Value &value, timestamp_t &result) {
+	Value timestamp;
+	if (value.IsNull() || !value.DefaultTryCastAs(LogicalType::TIMESTAMP, timestamp)) {
+		return false;
+	}
+	result = timestamp.GetValue<timestamp_t>();
+	return Timestamp::IsFinite(result);
+}
+
+// Number of distinct values the time dimension takes in the query: its distinct values, or the number of periods
+// of its granularity between its smallest and largest value within the date_range, if that is less
+static double EstimateTimeGroups(const SemanticTimeDimension &time_dim, const SemanticDatasetStatistics &statistics,
+                                 idx_t dimension_idx) {
+	double groups = static_cast<double>(statistics.cardinalities[dimension_idx]);
+	timestamp_t start, end;
+	if (time_dim.granularity.empty() || !TryGetTimestamp(statistics.min_values[dimension_idx], start) ||
+	    !TryGetTimestamp(statistics.max_values[dimension_idx], end)) {
+		return groups;
+	}
+	if (time_dim.date_range.size() == 2) {
+		timestamp_t range_start, range_end;
+		if (TryGetTimestamp(Value(time_dim.date_range[0]), range_start)) {
+			start = MaxValue(start, range_start);
+		}
+		if (TryGetTimestamp(Value(time_dim.date_range[1]), range_end)) {
+			// The last day of the range is included
+			end = MinValue(end, timestamp_t(range_end.value + Interval::MICROS_PER_DAY));
+		}
+	}
+	if (end < start) {
+		return 0;
+	}
+	auto periods = static_cast<double>((end.value - start.value) / MinimumPeriodMicros(time_dim.granularity) + 2);
+	return MinValue(groups, periods);
+}
+
+// Whether the filter leaves the dimension at most "bound" distinct values: those of an equals filter, the fewest of
+// any member of an and group, or the sum over the members of an or group, if each of them restricts the dimension
+static bool TryBoundFilterValues(const SemanticFilter &filter, const string &dimension, double &bound) {
+	if (!filter.IsGroup()) {
+		if (filter.dimension != dimension || filter.operator_ != "equals") {
+			return false;
+		}
+		bound = static_cast<double>(filter.values.size());
+		return true;
+	}
+	bool is_or = filter.operator_ == "or";
+	bool bounded = false;
+	double group_bound = 0;
+	for (auto &child : filter.filters) {
+		double child_bound;
+		if (!TryBoundFilterValues(child, dimension, child_bound)) {
+			if (is_or) {
+				return false;
+			}
+			continue;
+		}
+		if (is_or) {
+			group_bound += child_bound;
+		} else {
+			group_bound = bounded ? MinValue(group_bound, child_bound) : child_bound;
+		}
+		bounded = true;
+	}
+	bound = group_bound;
+	return bounded;
+}
+
+optional_idx EstimateSemanticQueryGroups(const SemanticQuery &query, const BoundSemanticQuery &bound) {
+	if (!bound.dataset->statistics) {
+		return optional_idx();
+	}
+	auto &statistics = *bound.dataset->statistics;
+	double groups = 1;
+	for (idx_t i = 0; i < bound.dimensions.size(); i++) {
+		auto cardinality = static_cast<double>(statistics.cardinalities[bound.dimensions[i]]);
+		// Equals filters on the dimension leave at most their values - the filters of the query are and-ed
+		for (auto &filter : query.filters) {
+			double filter_bound;
+			if (TryBoundFilterValues(filter, query.dimensions[i], filter_bound)) {
+				cardinality = MinValue(cardinality, filter_bound);
+			}
+		}
+		groups *= cardinality;
+	}
+	for (idx_t i = 0; i < bound.time_dimensions.size(); i++) {
+		groups *= EstimateTimeGroups(query.time_dimensions[i], statistics, bound.time_dimensions[i]);
+	}
+	if (!bound.dimensions.empty() || !bound.time_dimensions.empty()) {
+		// There are no more groups than rows
+		groups = MinValue(groups, static_cast<double>(statistics.row_count));
+	}
+	return optional_idx(static_cast<idx_t>(groups));
+}
+
+// semantic_max_groups setting
+static void SetSemanticMaxGroups(ClientContext &context, SetScope scope, Value &parameter) {
+	auto max_groups = parameter.GetValue<int64_t>();
+	if (max_groups < 0) {
+		throw InvalidInputException("semantic_max_groups must be non-negative");
+	}
+	auto &registry = DatasetRegistry::Get(context);
+	registry.SetMaxGroups(NumericCast<idx_t>(max_groups));
+	// Cached plans were only checked against the previous limit
+	registry.GetPlanCache().InvalidateAll();
+}
+
+// refresh_semantic_dataset_stats([dataset]) table function
+struct RefreshStatisticsData : public TableFunctionData {
+	//! Empty for all datasets
+	vector<string> datasets;
+};
+
+struct RefreshStatisticsState : public GlobalTableFunctionState {
+	bool refreshed = false;
+	vector<SemanticStatisticsRefresh> refreshes;
+	idx_t offset = 0;
+};
+
+static unique_ptr<FunctionData> RefreshStatisticsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                      vector<LogicalType> &return_types, vector<string> &names) {
+	auto result = make_uniq<RefreshStatisticsData>();
+	if (!input.inputs.empty()) {
+		result->datasets.push_back(input.inputs[0].GetValue<string>());
+	}
+	names = {"dataset", "row_count", "duration_ms"};
+	return_types = {LogicalType::VARCHAR, LogicalType::UBIGINT, LogicalType::DOUBLE};
+	return std::move(result);
+}
+
+static unique_ptr<GlobalTableFunctionState> RefreshStatisticsInit(ClientContext &context,
+                                                                  TableFunctionInitInput &input) {
+	return make_uniq<RefreshStatisticsState>();
+}
+
+static void RefreshStatisticsFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->Cast<RefreshStatisticsData>();
+	auto &state = data_p.global_state->Cast<RefreshStatisticsState>();
+	if (!state.refreshed) {
+		state.refreshed = true;
+		auto &registry = DatasetRegistry::Get(context);
+		auto datasets = data.datasets;
+		if (datasets.empty()) {
+			for (auto &entry : *registry.GetSnapshot()) {
+				datasets.push_back(entry.first);
+			}
+			std::sort(datasets.begin(), datasets.end());
+		}
+		state.refreshes = registry.RefreshStatistics(*context.db, datasets);
+	}
+
+	idx_t count = 0;
+	while (state.offset < state.refreshes.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &refresh = state.refreshes[state.offset++];
+		output.SetValue(0, count, Value(refresh.dataset));
+		output.SetValue(1, count, Value::UBIGINT(refresh.row_count));
+		output.SetValue(2, count, Value::DOUBLE(refresh.duration * 1000.0));
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+// semantic_dataset_stats() table function - one row per dimension of every dataset with statistics, or one row
+// without a dimension for datasets that have none
+struct SemanticDatasetStatsState : public GlobalTableFunctionState {
+	vector<vector<Value>> rows;
+	idx_t offset = 0;
+};
+
+static unique_ptr<FunctionData> SemanticDatasetStatsBind(ClientContext &context, TableFunctionBindInput &input,
+                                                         vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"dataset", "dimension", "row_count", "cardinality", "min_value", "max_value", "analyzed_at"};
+	return_types = {LogicalType::VARCHAR,   LogicalType::VARCHAR,   LogicalType::UBIGINT,  LogicalType::UBIGINT,
+	                LogicalType::TIMESTAMP, LogicalType::TIMESTAMP, LogicalType::TIMESTAMP};
+	return make_uniq<TableFunctionData>();
+}
+
+static unique_ptr<GlobalTableFunctionState> SemanticDatasetStatsInit(ClientContext &context,
+                                                                     TableFunctionInitInput &input) {
+	auto result = make_uniq<SemanticDatasetStatsState>();
+	vector<shared_ptr<const SemanticDataset>> datasets;
+	for (auto &entry : *DatasetRegistry::Get(context).GetSnapshot()) {
+		if (entry.second->statistics) {
+			datasets.push_back(entry.second);
+		}
+	}
+	std::sort(datasets.begin(), datasets.end(),
+	          [](const shared_ptr<const SemanticDataset> &a, const shared_ptr<const SemanticDataset> &b) {
+		          return a->name < b->name;
+	          });
+	for (auto &dataset : datasets) {
+		auto &statistics = *dataset->statistics;
+		auto row_count = Value::UBIGINT(statistics.row_count);
+		auto analyzed_at = Value::TIMESTAMP(statistics.analyzed_at);
+		if (dataset->dimensions.empty()) {
+			result->rows.push_back({Value(dataset->name), Value(), row_count, Value(LogicalType::UBIGINT),
+			                        Value(LogicalType::TIMESTAMP), Value(LogicalType::TIMESTAMP), analyzed_at});
+		}
+		for (idx_t i = 0; i < dataset->dimensions.size(); i++) {
+			result->rows.push_back({Value(dataset->name), Value(dataset->dimensions[i].name), row_count,
+			                        Value::UBIGINT(statistics.cardinalities[i]), statistics.min_values[i],
+			                        statistics.max_values[i], analyzed_at});
+		}
+	}
+	return std::move(result);
+}
+
+static void SemanticDatasetStatsFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &state = data_p.global_state->Cast<SemanticDatasetStatsState>();
+	idx_t count = 0;
+	while (state.offset < state.rows.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &row = state.rows[state.offset++];
+		for (idx_t col = 0; col < row.size(); col++) {
+			output.SetValue(col, count, row[col]);
+		}
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+void RegisterSemanticStatisticsFunctions(DatabaseInstance &instance) {
+	auto &config = DBConfig::GetConfig(instance);
+	config.AddExtensionOption("semantic_max_groups",
+	                          "Semantic queries predicted to return more groups than this, from the statistics of "
+	                          "their dataset, are refused (0 for no limit)",
+	                          LogicalType::BIGINT, Value::BIGINT(0), SetSemanticMaxGroups);
+
+	TableFunctionSet refresh_statistics("refresh_semantic_dataset_stats");
+	refresh_statistics.AddFunction(
+	    TableFunction({}, RefreshStatisticsFunction, RefreshStatisticsBind, RefreshStatisticsInit));
+	refresh_statistics.AddFunction(
+	    TableFunction({LogicalType::VARCHAR}, RefreshStatisticsFunction, RefreshStatisticsBind, RefreshStatisticsInit));
+	ExtensionUtil::RegisterFunction(instance, refresh_statistics);
+
+	TableFunction stats_func("semantic_dataset_stats", {}, SemanticDatasetStatsFunction, SemanticDatasetStatsBind,
+	                         SemanticDatasetStatsInit);
+	ExtensionUtil::RegisterFunction(instance, stats_func);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb
@@ -0,0 +1,228 @@
+#include "quack_extension.hpp"
+#include "semantic_result_cache.hpp"
+#include "duckdb/common/error_data.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/main/connection.hpp"
+#include "duckdb/main/extension_util.hpp"
+#include "duckdb/parallel/task_executor.hpp"
+
+#include <algorithm>
+#ifdef HAVE_NLOHMANN_JSON
+#include <nlohmann/json.hpp>
+#endif
+
+namespace duckdb {
+
+#ifdef HAVE_NLOHMANN_JSON
+
+//===--------------------------------------------------------------------===//
+// Warmup
+//===--------------------------------------------------------------------===//
+// The first query of a shape pays for parsing, validating, routing and compiling it. Warmups pay for that ahead of
+// time, by compiling the queries a dataset is expected to get into the plan cache: the queries its rollups answer -
+// dashboards are what rollups are declared for. Every dataset is warmed up when it is published, i.e. when it is
+// registered, loaded with the extension, or re-routed by a rollup refresh, unless the semantic_warmup setting is off.
+// semantic_warmup() warms datasets or given queries on demand, side by side on the TaskScheduler, and with
+// execute := true also runs them - through the result cache when it is enabled, which then holds their results, and
+// otherwise only to read their rollup and source tables into the buffer pool.
+using json = nlohmann::ordered_json;
+
+vector<string> GetSemanticWarmupQueries(const SemanticDataset &dataset) {
+	vector<string> queries;
+	for (auto &rollup : dataset.rollups) {
+		json query = {{"dataset", dataset.name}, {"measures", rollup.measures}};
+		if (!rollup.dimensions.empty()) {
+			query["dimensions"] = rollup.dimensions;
+		}
+		if (!rollup.time_dimension.empty()) {
+			json time_dimension = {{"dimension", rollup.time_dimension}, {"granularity", rollup.granularity}};
+			query["time_dimensions"] = json::array({time_dimension});
+		}
+		queries.push_back(query.dump());
+	}
+	return queries;
+}
+
+void DatasetRegistry::WarmupDatasets(const vector<string> &dataset_names) {
+	if (!warmup_) {
+		return;
+	}
+	for (auto &name : dataset_names) {
+		auto dataset = GetDataset(name);
+		if (!dataset) {
+			continue;
+		}
+		for (auto &query_json : GetSemanticWarmupQueries(*dataset)) {
+			string dataset_name;
+			shared_ptr<const SemanticDataset> compiled_dataset;
+			SemanticQueryTimings timings;
+			bool plan_cache_hit = false;
+			try {
+				CompileCachedSemanticQuery(*this, query_json, dataset_name, compiled_dataset, timings, plan_cache_hit);
+			} catch (std::exception &) {
+				// A warmup only saves time for later queries - it never fails the publication of a dataset
+				continue;
+			}
+		}
+	}
+}
+
+static void SetSemanticWarmup(ClientContext &context, SetScope scope, Value &parameter) {
+	DatasetRegistry::Get(context).SetWarmup(parameter.GetValue<bool>());
+}
+
+// semantic_warmup([dataset | queries], execute := false) table function
+struct SemanticWarmupResult {
+	string dataset;
+	//! Whether the plan of the query was cached already
+	bool cached = false;
+	string error;
+};
+
+struct SemanticWarmupData : public TableFunctionData {
+	vector<string> queries;
+	bool execute = false;
+};
+
+struct SemanticWarmupState : public GlobalTableFunctionState {
+	vector<SemanticWarmupResult> results;
+	idx_t offset = 0;
+};
+
+class SemanticWarmupTask : public BaseExecutorTask {
+public:
+	SemanticWarmupTask(TaskExecutor &executor, ClientContext &context, const string &query_json, bool execute,
+	                   SemanticWarmupResult &result)
+	    : BaseExecutorTask(executor), context(context), query_json(query_json), execute(execute), result(result) {
+	}
+
+	void ExecuteTask() override {
+		auto &registry = DatasetRegistry::Get(context);
+		shared_ptr<const SemanticDataset> dataset;
+		SemanticQueryTimings timings;
+		try {
+			auto plan =
+			    CompileCachedSemanticQuery(registry, query_json, result.dataset, dataset, timings, result.cached);
+			if (execute) {
+				Execute(registry, *dataset, plan->ToString());
+			}
+		} catch (std::exception &ex) {
+			// Reported per query, so that one broken query does not keep the others from being warmed up
+			ErrorData error(ex);
+			result.error = error.RawMessage();
+		}
+	}
+
+private:
+	void Execute(DatasetRegistry &registry, const SemanticDataset &dataset, const string &sql) {
+		if (registry.GetResultCache().Enabled()) {
+			ExecuteCachedSemanticQuery(context, dataset, sql);
+			return;
+		}
+		auto con = MakeSemanticSideConnection(context);
+		auto query_result = con->Query(sql);
+		if (query_result->HasError()) {
+			query_result->ThrowError();
+		}
+	}
+
+	ClientContext &context;
+	const string &query_json;
+	bool execute;
+	SemanticWarmupResult &result;
+};
+
+static unique_ptr<FunctionData> SemanticWarmupBind(ClientContext &context, TableFunctionBindInput &input,
+                                                   vector<LogicalType> &return_types, vector<string> &names) {
+	auto result = make_uniq<SemanticWarmupData>();
+	auto &registry = DatasetRegistry::Get(context);
+	if (input.inputs.empty()) {
+		// All datasets, in name order
+		vector<shared_ptr<const SemanticDataset>> datasets;
+		for (auto &entry : *registry.GetSnapshot()) {
+			datasets.push_back(entry.second);
+		}
+		std::sort(datasets.begin(), datasets.end(),
+		          [](const shared_ptr<const SemanticDataset> &a, const shared_ptr<const SemanticDataset> &b) {
+			          return a->name < b->name;
+		          });
+		for (auto &dataset : datasets) {
+			auto queries = GetSemanticWarmupQueries(*dataset);
+			result->queries.insert(result->queries.end(), queries.begin(), queries.end());
+		}
+	} else if (input.inputs[0].type().id() == LogicalTypeId::LIST) {
+		for (auto &query : ListValue::GetChildren(input.inputs[0])) {
+			if (query.IsNull()) {
+				throw InvalidInputException("semantic_warmup queries cannot be NULL");
+			}
+			result->queries.push_back(StringValue::Get(query));
+		}
+	} else {
+		auto dataset_name = input.inputs[0].GetValue<string>();
+		auto dataset = registry.GetDataset(dataset_name);
+		if (!dataset) {
+			throw InvalidInputException("Dataset '%s' not found in registry", dataset_name);
+		}
+		result->queries = GetSemanticWarmupQueries(*dataset);
+	}
+	auto execute = input.named_parameters.find("execute");
+	if (execute != input.named_parameters.end() && !execute->second.IsNull()) {
+		result->execute = execute->second.GetValue<bool>();
+	}
+	names = {"dataset", "query", "cached", "error"};
+	return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::BOOLEAN, LogicalType::VARCHAR};
+	return std::move(result);
+}
+
+// The queries are warmed up here, before the first row is returned. The calling thread works on the tasks too.
+static unique_ptr<GlobalTableFunctionState> SemanticWarmupInit(ClientContext &context, TableFunctionInitInput &input) {
+	auto &data = input.bind_data->Cast<SemanticWarmupData>();
+	auto result = make_uniq<SemanticWarmupState>();
+	result->results.resize(data.queries.size());
+	TaskExecutor executor(context);
+	for (idx_t i = 0; i < data.queries.size(); i++) {
+		executor.ScheduleTask(
+		    make_uniq<SemanticWarmupTask>(executor, context, data.queries[i], data.execute, result->results[i]));
+	}
+	executor.WorkOnTasks();
+	return std::move(result);
+}
+
+static void SemanticWarmupFunction(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->Cast<SemanticWarmupData>();
+	auto &state = data_p.global_state->Cast<SemanticWarmupState>();
+	idx_t count = 0;
+	while (state.offset < state.results.size() && count < STANDARD_VECTOR_SIZE) {
+		auto &result = state.results[state.offset];
+		output.SetValue(0, count, result.dataset.empty() ? Value() : Value(result.dataset));
+		output.SetValue(1, count, Value(data.queries[state.offset]));
+		output.SetValue(2, count, result.error.empty() ? Value::BOOLEAN(result.cached) : Value());
+		output.SetValue(3, count, result.error.empty() ? Value() : Value(result.error));
+		state.offset++;
+		count++;
+	}
+	output.SetCardinality(count);
+}
+
+void RegisterSemanticWarmupFunctions(DatabaseInstance &instance) {
+	auto &config = DBConfig::GetConfig(instance);
+	config.AddExtensionOption("semantic_warmup",
+	                          "Whether registered, loaded and refreshed datasets have the queries their rollups answer "
+	                          "compiled into the plan cache right away",
+	                          LogicalType::BOOLEAN, Value::BOOLEAN(true), SetSemanticWarmup);
+
+	TableFunctionSet warmup_set("semantic_warmup");
+	for (auto &arguments : {vector<LogicalType>(), vector<LogicalType> {LogicalType::VARCHAR},
+	                        vector<LogicalType> {LogicalType::LIST(LogicalType::VARCHAR)}}) {
+		TableFunction warmup_func(arguments, SemanticWarmupFunction, SemanticWarmupBind, SemanticWarmupInit);
+		warmup_func.named_parameters["execute"] = LogicalType::BOOLEAN;
+		warmup_set.AddFunction(warmup_func);
+	}
+	ExtensionUtil::RegisterFunction(instance, warmup_set);
+}
+
+#endif // HAVE_NLOHMANN_JSON
+
+} // namespace duckdb